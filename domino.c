@@ -1,5 +1,5 @@
 // domino.c — Planificador por mesa (FCFS / SJF_POINTS / SJF_PLAYERS / RR) + 1 acción por turno
-#define _POSIX_C_SOURCE 200809L
+#define _GNU_SOURCE // pthread_setaffinity_np / CPU_SET (afinidad y NUMA)
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,9 +8,31 @@
 #include <unistd.h>
 #include <limits.h>
 #include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <strings.h>
+#include <math.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
-#define MAX_PLAYERS 4
-#define MAX_TILES 28
+#ifndef MAX_PIP
+#define MAX_PIP 12 // mayor juego compilado (doble-12); -DMAX_PIP=6 o 9 reduce el estado por mesa
+#endif
+#ifndef MAX_PLAYERS
+#define MAX_PLAYERS 8
+#endif
+#define SET_TILES(pips) (((pips) + 1) * ((pips) + 2) / 2) // fichas del juego doble-'pips'
+#define MAX_TILES SET_TILES(MAX_PIP)
+#define HAND_DEAL 7 // fichas por jugador al repartir
+#define MAX_POOL (MAX_TILES - 2 * HAND_DEAL) // pozo tras repartir a 2 jugadores
+#define MAX_STEPS 800 // fin forzado de la mesa
 #define ACTION_Q_CAP 1024
 #define DEFAULT_TURN_COOLDOWN_MS 0 // enfriamiento configurable por turno planificado
 
@@ -46,33 +68,276 @@ typedef enum
     TERMINATED
 } pstate_t;
 
+/* ===== fichas =====
+ * Una ficha es un byte: su índice hi * (hi + 1) / 2 + lo. Los juegos menores
+ * son prefijos del mayor (doble-6: 0..27, doble-9: 0..54, doble-12: 0..90) y
+ * los números salen de TILE_LO / TILE_HI. Las manos y las fichas jugadas son
+ * máscaras tmask_t, del ancho justo para el mayor juego compilado; los núcleos
+ * del motor y de PIMC las leen con la máscara más estrecha del juego en curso.
+ */
+typedef uint8_t tile_t;
+
+static inline int ctz128(unsigned __int128 m)
+{
+    uint64_t lo = (uint64_t)m;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t)(m >> 64));
+}
+
+static inline int popcount128(unsigned __int128 m)
+{
+    return __builtin_popcountll((uint64_t)m) + __builtin_popcountll((uint64_t)(m >> 64));
+}
+
+#if MAX_PIP > 9
+typedef unsigned __int128 tmask_t;
+#define tmask_ctz ctz128
+#define tmask_popcount popcount128
+#elif MAX_PIP > 6
+typedef uint64_t tmask_t;
+#define tmask_ctz __builtin_ctzll
+#define tmask_popcount __builtin_popcountll
+#else
+typedef uint32_t tmask_t;
+#define tmask_ctz __builtin_ctz
+#define tmask_popcount __builtin_popcount
+#endif
+#define TILE_BIT(t) ((tmask_t)1 << (t))
+
+static uint8_t TILE_LO[MAX_TILES], TILE_HI[MAX_TILES];
+static tmask_t NUM_MASK[MAX_PIP + 1]; // fichas que contienen cada número
+static uint32_t NUM_MASK32[MAX_PIP + 1];
+#if MAX_PIP > 6
+static uint64_t NUM_MASK64[MAX_PIP + 1];
+#endif
+
+static void tile_masks_init(void)
+{
+    for (int hi = 0, i = 0; hi <= MAX_PIP; hi++)
+        for (int lo = 0; lo <= hi; lo++, i++)
+        {
+            TILE_LO[i] = (uint8_t)lo;
+            TILE_HI[i] = (uint8_t)hi;
+            NUM_MASK[lo] |= TILE_BIT(i);
+            NUM_MASK[hi] |= TILE_BIT(i);
+        }
+    for (int n = 0; n <= MAX_PIP; n++)
+    {
+        NUM_MASK32[n] = (uint32_t)NUM_MASK[n]; // el doble-6 ocupa los 28 bits bajos
+#if MAX_PIP > 6
+        NUM_MASK64[n] = (uint64_t)NUM_MASK[n];
+#endif
+    }
+}
+
+static inline int tile_fits(tile_t t, int end) { return TILE_LO[t] == end || TILE_HI[t] == end; }
+// el otro número de la ficha una vez colocada sobre 'end'
+static inline int tile_other(tile_t t, int end) { return TILE_LO[t] == end ? TILE_HI[t] : TILE_LO[t]; }
+
+/* ----- núcleos del motor por ancho de máscara -----
+ * ENGINE_KERNELS(W, ...) instancia para máscaras de W bits:
+ *   mask_points_W     puntos de las fichas de la máscara
+ *   find_play_W       ficha de menor índice que encaja, primero a la izquierda
+ *   choose_opening_W  el doble más alto abre; sin dobles, la mayor suma
+ * Las manos se guardan como tmask_t, pero cada núcleo las lee en su ancho:
+ * con el doble-6 las fichas caben en los 32 bits bajos y ni la búsqueda de
+ * jugada ni el recuento de puntos tocan el resto. engine_select_kernels
+ * elige el ancho del juego en curso, como pimc_select_kernels.
+ */
+#define ENGINE_KERNELS(W, mask_t, NUMS, CTZ)                                                            \
+    static int mask_points_##W(mask_t m)                                                                \
+    {                                                                                                   \
+        int s = 0;                                                                                      \
+        for (; m; m &= m - 1)                                                                           \
+        {                                                                                               \
+            int i = CTZ(m);                                                                             \
+            s += TILE_LO[i] + TILE_HI[i];                                                               \
+        }                                                                                               \
+        return s;                                                                                       \
+    }                                                                                                   \
+                                                                                                        \
+    static int hand_points_##W(tmask_t hand) { return mask_points_##W((mask_t)hand); }                  \
+                                                                                                        \
+    static int find_play_##W(tmask_t hand, int left, int right, tile_t *tile_out, int *side_out)        \
+    {                                                                                                   \
+        mask_t m = (mask_t)hand & NUMS[left];                                                           \
+        *side_out = -1;                                                                                 \
+        if (!m)                                                                                         \
+        {                                                                                               \
+            m = (mask_t)hand & NUMS[right];                                                             \
+            *side_out = +1;                                                                             \
+        }                                                                                               \
+        if (!m)                                                                                         \
+            return 0;                                                                                   \
+        *tile_out = (tile_t)CTZ(m);                                                                     \
+        return 1;                                                                                       \
+    }                                                                                                   \
+                                                                                                        \
+    static void choose_opening_##W(const tmask_t hands[], int nplayers, int *opener_out, tile_t *tile_out) \
+    {                                                                                                   \
+        int opener = -1, best_val = -1, best_is_double = 0;                                             \
+        for (int p = 0; p < nplayers; p++)                                                              \
+            for (mask_t m = (mask_t)hands[p]; m; m &= m - 1)                                            \
+            {                                                                                           \
+                tile_t t = (tile_t)CTZ(m);                                                              \
+                if (TILE_LO[t] == TILE_HI[t])                                                           \
+                {                                                                                       \
+                    if (!best_is_double || TILE_LO[t] > best_val)                                       \
+                    {                                                                                   \
+                        best_is_double = 1;                                                             \
+                        best_val = TILE_LO[t];                                                          \
+                        opener = p;                                                                     \
+                        *tile_out = t;                                                                  \
+                    }                                                                                   \
+                }                                                                                       \
+                else if (!best_is_double && TILE_LO[t] + TILE_HI[t] > best_val)                         \
+                {                                                                                       \
+                    best_val = TILE_LO[t] + TILE_HI[t];                                                 \
+                    opener = p;                                                                         \
+                    *tile_out = t;                                                                      \
+                }                                                                                       \
+            }                                                                                           \
+        if (opener < 0)                                                                                 \
+        {                                                                                               \
+            opener = 0;                                                                                 \
+            *tile_out = (tile_t)CTZ((mask_t)hands[0]);                                                  \
+        }                                                                                               \
+        *opener_out = opener;                                                                           \
+    }
+
+ENGINE_KERNELS(32, uint32_t, NUM_MASK32, __builtin_ctz)
+#if MAX_PIP > 6
+ENGINE_KERNELS(64, uint64_t, NUM_MASK64, __builtin_ctzll)
+#endif
+#if MAX_PIP > 9
+ENGINE_KERNELS(128, unsigned __int128, NUM_MASK, ctz128)
+#endif
+
+// núcleos del motor para el juego en curso (los fija engine_select_kernels)
+static struct
+{
+    int (*points)(tmask_t hand);
+    int (*find_play)(tmask_t hand, int left, int right, tile_t *tile_out, int *side_out);
+    void (*opening)(const tmask_t hands[], int nplayers, int *opener_out, tile_t *tile_out);
+} ENGINE = {hand_points_32, find_play_32, choose_opening_32};
+
+// núcleo más estrecho en el que caben las fichas del juego
+static void engine_select_kernels(int pips)
+{
+    (void)pips; // sin uso si solo se compiló el doble-6
+#if MAX_PIP > 6
+    if (SET_TILES(pips) > 32)
+    {
+        ENGINE.points = hand_points_64;
+        ENGINE.find_play = find_play_64;
+        ENGINE.opening = choose_opening_64;
+    }
+#endif
+#if MAX_PIP > 9
+    if (SET_TILES(pips) > 64)
+    {
+        ENGINE.points = hand_points_128;
+        ENGINE.find_play = find_play_128;
+        ENGINE.opening = choose_opening_128;
+    }
+#endif
+}
+
+typedef enum
+{
+    END_NONE,
+    END_DOMINA,    // un jugador colocó su última ficha
+    END_BLOCKED,   // cierre por bloqueo: gana el menor puntaje
+    END_STEP_LIMIT // fin forzado por MAX_STEPS
+} end_reason_t;
+
+/* ===== instantánea de mesa (seqlock) =====
+ * Resumen de solo lectura que publica quien modifica la mesa (siempre con
+ * g->mtx tomado, así que hay un único escritor por mesa). Los lectores
+ * (supervisor, consola, monitor) nunca toman g->mtx: reintentan si la
+ * secuencia es impar o cambió durante la copia.
+ */
 typedef struct
 {
-    int a, b;
-} tile_t;
+    uint8_t nplayers, turn, left_end, right_end;
+    uint8_t hand_len[MAX_PLAYERS];
+    uint16_t points[MAX_PLAYERS];
+    uint8_t pool_len, pass_streak, finished;
+    uint16_t steps;
+    policy_t policy;
+    int rr_quantum_ms, turn_cooldown_ms;
+} table_summary_t;
 
 typedef struct
 {
-    tile_t train[128];
-    int train_len;
-    int left_end, right_end;
-    tile_t hands[MAX_PLAYERS][14];
-    int hand_len[MAX_PLAYERS];
-    tile_t pool[28];
-    int pool_len;
+    atomic_uint seq;
+    table_summary_t s;
+} table_snapshot_t;
+
+// temporizador de la rueda (ver "rueda de temporizadores jerárquica")
+typedef enum
+{
+    TIMER_IDLE,
+    TIMER_ARMED,
+    TIMER_FIRING
+} timer_state_t;
+
+typedef struct wheel_timer_s
+{
+    struct wheel_timer_s *next, *prev;
+    uint64_t expires; // tic absoluto
+    void (*fn)(void *arg);
+    void *arg;
+    timer_state_t state; // W.mtx
+} wheel_timer_t;
 
-    int nplayers, turn, table_id, finished;
-    int steps, max_steps;
-    int pass_streak;
+typedef struct
+{
+    // partida: manos y línea como máscaras, pozo en orden de robo
+    tmask_t hands[MAX_PLAYERS];
+    tmask_t played;            // fichas colocadas en la línea
+    tile_t pool[MAX_POOL];     // se roba desde el final
+    uint8_t pool_len, train_len;
+    uint8_t left_end, right_end;
+    uint8_t hand_len[MAX_PLAYERS]; // popcount(hands[p]), mantenido al jugar y robar
+    uint16_t voids[MAX_PLAYERS];   // bit n: el jugador pasó con n en un extremo (información pública)
+    uint8_t nplayers, turn, pass_streak, finished;
+    int8_t winner;      // -1 si no hay ganador
+    uint8_t end_reason; // end_reason_t
+    uint16_t steps;
+    int16_t cpu;   // CPU asignada a la mesa (-1 => sin fijar)
+    int table_id;
+    int gid;       // id global de la mesa (igual a table_id salvo en modo distribuido)
+    uint32_t seed; // semilla del reparto
+    uint8_t dealt;  // reparto ya aplicado (anticipado por el repartidor)
+    uint8_t opener; // jugador que abrió
+    tile_t opening; // ficha de apertura
+    long long start_ns, end_ns;
+    long long turn_lat_sum_ns;  // suma de latencias de turno de esta mesa (validador)
 
     // NUEVO: planificación y sincronización de turnos
     policy_t policy;
-    int rr_quantum_ms; // reservado para permitir N acciones por quantum en el futuro
+    uint8_t init_policy;    // política con la que arrancó la mesa
+    uint8_t switches;       // cambios de política aplicados (saturado a 255)
+    uint8_t auto_policy;    // el supervisor automático puede cambiar la política de esta mesa
+    uint8_t perturbed;      // cambio de política o acción forzada: el resultado no se cachea
+    uint32_t cfg_epoch;     // última época de la configuración global aplicada
+    uint8_t action_done;    // lo setea el validador tras aplicar una acción
+    uint8_t turn_ready;     // venció el cooldown del turno abierto (lo marca la rueda)
+    uint8_t turn_submitted; // 0: nada encolado; 1: el jugador encoló; 2: forzada por quantum
+    int rr_quantum_ms; // RR: plazo para actuar desde que el turno está listo
     int turn_cooldown_ms;
-    int action_done;   // lo setea el validador tras aplicar una acción
+    int turn_seq;      // se incrementa cada vez que el planificador abre un turno
+    long long ready_at_ns, quantum_at_ns; // plazos armados (descartan disparos tardíos)
+    long long turn_open_ns;  // cuándo abrió el turno el planificador
+    long long turn_delay_ns; // espera deliberada del jugador (cooldown + think)
+    wheel_timer_t t_ready, t_quantum;
+    pthread_t th_players[MAX_PLAYERS];
+    unsigned spawned; // bit p: el jugador p ya tiene hilo (se crea en su primer turno)
 
     pthread_mutex_t mtx;
     pthread_cond_t cv;
+
+    table_snapshot_t snap; // vista consistente para lectores sin bloqueo
 } game_state_t;
 
 typedef struct
@@ -85,9 +350,167 @@ typedef struct
     long runs, io_ops;
 } pcb_t;
 
+/* ===== configuración de ejecución (línea de comandos) ===== */
+typedef enum
+{
+    LOAD_ALL_AT_ONCE, // todas las mesas arrancan juntas (comportamiento clásico)
+    LOAD_CONST,       // llegadas equiespaciadas a 'rate' mesas/s
+    LOAD_POISSON,     // llegadas con separación exponencial de media 1/rate
+    LOAD_BURST        // ráfagas de 'burst' mesas, rate medio mesas/s
+} load_kind_t;
+
+typedef enum
+{
+    THINK_NONE,
+    THINK_CONST,   // think_ms fijo
+    THINK_EXP,     // exponencial de media think_ms
+    THINK_UNIFORM  // uniforme en [0, 2*think_ms]
+} think_kind_t;
+
+typedef enum
+{
+    STRAT_FIRST, // primera ficha jugable, extremo izquierdo antes que el derecho
+    STRAT_PIMC   // Monte Carlo sobre repartos compatibles con lo visto
+} strategy_t;
+
+typedef struct
+{
+    int n_tables;           // 0 => se pregunta por consola
+    int bp_target_ms;       // objetivo de latencia de servicio; 0 => contrapresión desactivada
+    int bp_max_cooldown_ms; // tope del enfriamiento adaptativo
+    int bp_tick_ms;         // periodo del controlador
+    int stats_ms;           // periodo del reporte de estadísticas (0 => solo al final)
+    int pin;                // fija validador/mesas a CPUs y coloca cada mesa en su nodo NUMA
+    int monitor_ms;         // periodo del monitor agregado (0 => desactivado)
+    const char *events_shm; // nombre shm del flujo de eventos (NULL => desactivado)
+    int events_cap;         // registros del anillo (potencia de 2)
+    const char *tail_events; // modo lector: tail del flujo indicado
+    int quiet;              // silencia el registro de partida
+    int auto_policy;        // el supervisor automático puede cambiar políticas
+    policy_t default_policy;
+    unsigned seed;          // 0 => se toma del reloj
+
+    // generador de carga
+    load_kind_t load;
+    int rate;               // mesas/s ofrecidas
+    int burst;              // mesas por ráfaga (LOAD_BURST)
+    think_kind_t think;
+    int think_ms;
+    int saturate;           // búsqueda automática de la rodilla de saturación
+    int trial_ms;           // duración aproximada de la ventana de llegadas por prueba
+    int experiment;         // A/B de políticas sobre los mismos repartos (--tables = repartos)
+    const char *experiment_csv; // resultados por reparto y brazo
+
+    // modo distribuido
+    int workers;            // procesos trabajadores (0 => un solo proceso)
+    int worker_inflight;    // mesas activas como máximo por trabajador
+    int worker_batch;       // mesas por lote de asignación / resultados por mensaje
+
+    const char *trace_out;  // volcado Chrome trace-event (requiere -DDOMINO_TRACE)
+    int lock_stats;         // contención por lock y sitio de llamada, informe al salir
+
+    // estrategia de los jugadores
+    strategy_t strategy;
+    unsigned pimc_seats;    // máscara de asientos que usan PIMC
+    int pimc_budget_us;     // plazo de decisión por turno
+    int pimc_threads;       // hilos del pool de partidas simuladas (-1 => CPUs - 1)
+    int speculate;          // decidir la próxima acción mientras se espera el turno
+
+    // juego de fichas y mesas
+    int pips;               // doble-6 | doble-9 | doble-12 (<= MAX_PIP)
+    int max_players;        // jugadores por mesa: de 2 a max_players según la semilla
+
+    int outcome_cache;      // entradas de la caché de resultados (0 => desactivada)
+    const char *outcome_cache_file; // persistencia de la caché entre ejecuciones
+
+    // parámetros del planificador y del supervisor (ajustables con --autotune)
+    int turn_cooldown_ms;   // enfriamiento base de cada turno
+    int blocked_cooldown_ms; // enfriamiento extra mientras la mesa está en racha de pases
+    int quantum_ms;         // quantum de las mesas en RR
+    int idle_quantum_ms;    // quantum guardado en las mesas que no están en RR
+    int queue_cap;          // capacidad inicial de GQ y techo del límite de admisión
+    int supervisor_ms;      // periodo de control_thread
+    int policy_poll_ms;     // espera de policy_supervisor_thread con la cola vacía
+    int autotune;           // busca la configuración más rápida de los parámetros anteriores
+    int autotune_reps;      // repeticiones por configuración (se toma la mediana)
+    const char *autotune_out; // fichero de configuración resultante
+
+    const char *results;    // almacén columnar de resultados (NULL => desactivado)
+    const char *query;      // modo consulta: agrega el almacén indicado y sale
+    int query_by;           // rq_by_t: columna de agrupación
+
+    int predeal;            // repartos preparados por delante del lanzamiento (0 => cada mesa reparte)
+    int launchers;          // hilos que lanzan mesas en paralelo con --load=all (0 => según CPUs)
+    int max_running;        // mesas en marcha a la vez (0 => sin tope)
+} run_config_t;
+
+static run_config_t CFG = {
+    .n_tables = 0,
+    .bp_target_ms = 0,
+    .bp_max_cooldown_ms = 200,
+    .bp_tick_ms = 10,
+    .stats_ms = 0,
+    .pin = 0,
+    .monitor_ms = 0,
+    .events_shm = NULL,
+    .events_cap = 65536,
+    .tail_events = NULL,
+    .quiet = 0,
+    .auto_policy = 1,
+    .default_policy = SJF_POINTS, // FCFS | SJF_POINTS | SJF_PLAYERS | RR
+    .seed = 0,
+    .load = LOAD_ALL_AT_ONCE,
+    .rate = 50,
+    .burst = 10,
+    .think = THINK_NONE,
+    .think_ms = 0,
+    .saturate = 0,
+    .trial_ms = 2000,
+    .experiment = 0,
+    .experiment_csv = NULL,
+    .workers = 0,
+    .worker_inflight = 64,
+    .worker_batch = 16,
+    .trace_out = NULL,
+    .lock_stats = 0,
+    .strategy = STRAT_FIRST,
+    .pimc_seats = (1u << MAX_PLAYERS) - 1,
+    .pimc_budget_us = 2000,
+    .pimc_threads = -1,
+    .speculate = 0,
+    .pips = 6,
+    .max_players = 4,
+    .outcome_cache = 0,
+    .outcome_cache_file = NULL,
+    .turn_cooldown_ms = DEFAULT_TURN_COOLDOWN_MS,
+    .blocked_cooldown_ms = 75,
+    .quantum_ms = 120,
+    .idle_quantum_ms = 200,
+    .queue_cap = ACTION_Q_CAP,
+    .supervisor_ms = 100,
+    .policy_poll_ms = 50,
+    .autotune = 0,
+    .autotune_reps = 3,
+    .autotune_out = "domino.conf",
+    .results = NULL,
+    .query = NULL,
+    .query_by = 0,
+    .predeal = 256,
+    .launchers = 0,
+    .max_running = 0,
+};
+
+// registro de partida (acciones, manos, ajustes del supervisor); --quiet lo silencia
+#define TLOG(...)                \
+    do                           \
+    {                            \
+        if (!CFG.quiet)          \
+            printf(__VA_ARGS__); \
+    } while (0)
+
 /* ===== control en caliente: prototipos ===== */
-struct game_state_s;                                    // fwd si deseas; aquí no es estrictamente necesario
-static int all_tables_finished(game_state_t *t, int n); // ya existe más abajo: solo prototipo
+struct game_state_s;           // fwd si deseas; aquí no es estrictamente necesario
+static int comp_all_done(void); // seguimiento de finalización, más abajo
 
 typedef struct
 {
@@ -98,9 +521,42 @@ typedef struct
 void *control_thread(void *arg);
 
 /* ===== util ===== */
-static inline int is_double(tile_t t) { return t.a == t.b; }
-static inline int tile_sum(tile_t t) { return t.a + t.b; }
-static void print_tile(tile_t t) { printf("[%d|%d]", t.a, t.b); }
+static inline int is_double(tile_t t) { return TILE_LO[t] == TILE_HI[t]; }
+static inline int tile_sum(tile_t t) { return TILE_LO[t] + TILE_HI[t]; }
+static void print_tile(tile_t t) { printf("[%d|%d]", TILE_LO[t], TILE_HI[t]); }
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// splitmix64: barato, sin estado compartido (un generador por hilo)
+typedef struct
+{
+    uint64_t s;
+} rng_t;
+
+static uint64_t rng_next(rng_t *r)
+{
+    uint64_t z = (r->s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+static double rng_unit(rng_t *r) { return (double)(rng_next(r) >> 11) * 0x1.0p-53; }
+static double rng_exp(rng_t *r, double mean) { return -mean * log(1.0 - rng_unit(r)); }
+
+static void sleep_ns(long long ns)
+{
+    if (ns <= 0)
+        return;
+    struct timespec ts = {.tv_sec = ns / 1000000000LL, .tv_nsec = ns % 1000000000LL};
+    struct timespec rem = {0};
+    while (nanosleep(&ts, &rem) == -1 && errno == EINTR)
+        ts = rem;
+}
 
 static void sleep_ms(int ms)
 {
@@ -115,13 +571,7 @@ static void sleep_ms(int ms)
         ts = rem;
 }
 
-static int hand_points(game_state_t *g, int pid)
-{
-    int s = 0;
-    for (int i = 0; i < g->hand_len[pid]; ++i)
-        s += g->hands[pid][i].a + g->hands[pid][i].b;
-    return s;
-}
+static int hand_points(game_state_t *g, int pid) { return ENGINE.points(g->hands[pid]); }
 static int winner_lowest_points(game_state_t *g)
 {
     int win = -1, best_pts = INT_MAX, best_tiles = INT_MAX;
@@ -140,1021 +590,6901 @@ static int winner_lowest_points(game_state_t *g)
 }
 static void print_points_table(game_state_t *g)
 {
+    if (CFG.quiet)
+        return;
     printf("---- Puntajes de cierre (mesa %d) ----\n", g->table_id);
     for (int p = 0; p < g->nplayers; p++)
         printf("J%d: %d puntos (%d fichas)\n", p, hand_points(g, p), g->hand_len[p]);
 }
 
-/* ===== mazo / reparto ===== */
-static void build_deck(tile_t d[MAX_TILES], int *len)
-{
-    int k = 0;
-    for (int i = 0; i <= 6; i++)
-        for (int j = i; j <= 6; j++)
-            d[k++] = (tile_t){i, j};
-    *len = k;
-}
-static void shuffle_deck(tile_t d[], int len)
+/* ===== trazas de intervalos (solo con -DDOMINO_TRACE) =====
+ * TRACE_BEGIN(v) / TRACE_END(v, "nombre") marcan un intervalo con
+ * CLOCK_MONOTONIC y lo guardan en el búfer del hilo actual (sin locks:
+ * solo el registro de un búfer nuevo toma TRACE_MTX); TRACE_SPAN registra
+ * un intervalo ya medido. Sin la macro
+ * DOMINO_TRACE se compilan a nada. Al terminar, --trace-out=f.json
+ * vuelca todo en formato Chrome trace-event (chrome://tracing, Perfetto).
+ * Los búferes son bloques de TRACE_CHUNK intervalos; el total está acotado
+ * por TRACE_MAX_SPANS y lo que no cabe se cuenta como descartado. */
+#ifdef DOMINO_TRACE
+#define TRACE_CHUNK 512
+#define TRACE_MAX_SPANS (1L << 22)
+
+typedef struct
 {
-    for (int i = len - 1; i > 0; i--)
-    {
-        int j = rand() % (i + 1);
-        tile_t t = d[i];
-        d[i] = d[j];
-        d[j] = t;
-    }
-}
-static tile_t take_from_hand(game_state_t *g, int p, int idx)
+    const char *name; // literal: no se copia
+    long long t0_ns;
+    long long dur_ns;
+} trace_span_t;
+
+typedef struct trace_chunk_s
 {
-    tile_t t = g->hands[p][idx];
-    for (int i = idx + 1; i < g->hand_len[p]; ++i)
-        g->hands[p][i - 1] = g->hands[p][i];
-    g->hand_len[p]--;
-    return t;
-}
-static void add_to_hand(game_state_t *g, int p, tile_t t)
+    struct trace_chunk_s *next;
+    int len;
+    trace_span_t spans[TRACE_CHUNK];
+} trace_chunk_t;
+
+typedef struct trace_buf_s
 {
-    if (g->hand_len[p] < 14)
-        g->hands[p][g->hand_len[p]++] = t;
-}
-static void deal_hands(game_state_t *g)
+    struct trace_buf_s *next; // lista global de búferes (todos los hilos)
+    int tid;                  // id secuencial para el volcado
+    const char *thread_name;
+    trace_chunk_t *head, *cur;
+} trace_buf_t;
+
+static pthread_mutex_t TRACE_MTX = PTHREAD_MUTEX_INITIALIZER;
+static trace_buf_t *TRACE_BUFS = NULL;
+static int TRACE_NEXT_TID = 0;
+static atomic_long TRACE_SPANS = 0;   // intervalos reservados (para el tope)
+static atomic_long TRACE_DROPPED = 0; // intervalos descartados por el tope
+static __thread trace_buf_t *TRACE_TLS = NULL;
+static __thread const char *TRACE_TLS_NAME = "hilo";
+
+static trace_buf_t *trace_buf(void)
 {
-    tile_t deck[MAX_TILES];
-    int len = 0;
-    build_deck(deck, &len);
-    shuffle_deck(deck, len);
-    int idx = 0;
-    for (int p = 0; p < g->nplayers; p++)
-    {
-        g->hand_len[p] = 7;
-        for (int c = 0; c < 7; c++)
-            g->hands[p][c] = deck[idx++];
-    }
-    g->pool_len = 0;
-    while (idx < len)
-        g->pool[g->pool_len++] = deck[idx++];
-    g->train_len = 0;
+    if (TRACE_TLS)
+        return TRACE_TLS;
+    trace_buf_t *b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+    b->thread_name = TRACE_TLS_NAME;
+    pthread_mutex_lock(&TRACE_MTX);
+    b->tid = TRACE_NEXT_TID++;
+    b->next = TRACE_BUFS;
+    TRACE_BUFS = b;
+    pthread_mutex_unlock(&TRACE_MTX);
+    TRACE_TLS = b;
+    return b;
 }
-static void choose_opening(game_state_t *g, int *opener_out, tile_t *tile_out)
+
+static void trace_record(const char *name, long long t0_ns, long long t1_ns)
 {
-    int opener = -1, best_val = -1, best_is_double = 0, bp = -1, bi = -1;
-    for (int p = 0; p < g->nplayers; p++)
+    trace_buf_t *b = trace_buf();
+    if (!b)
+        return;
+    if (!b->cur || b->cur->len == TRACE_CHUNK)
     {
-        for (int i = 0; i < g->hand_len[p]; i++)
+        if (atomic_fetch_add(&TRACE_SPANS, TRACE_CHUNK) >= TRACE_MAX_SPANS)
         {
-            tile_t t = g->hands[p][i];
-            int val = tile_sum(t);
-            if (is_double(t))
-            {
-                if (!best_is_double || t.a > best_val)
-                {
-                    best_is_double = 1;
-                    best_val = t.a;
-                    opener = p;
-                    bp = p;
-                    bi = i;
-                    *tile_out = t;
-                }
-            }
-            else if (!best_is_double)
-            {
-                if (val > best_val)
-                {
-                    best_val = val;
-                    opener = p;
-                    bp = p;
-                    bi = i;
-                    *tile_out = t;
-                }
-            }
+            atomic_fetch_sub(&TRACE_SPANS, TRACE_CHUNK);
+            atomic_fetch_add(&TRACE_DROPPED, 1);
+            return;
         }
+        trace_chunk_t *c = malloc(sizeof(*c));
+        if (!c)
+            return;
+        c->next = NULL;
+        c->len = 0;
+        if (b->cur)
+            b->cur->next = c;
+        else
+            b->head = c;
+        b->cur = c;
     }
-    if (opener < 0)
+    trace_span_t *s = &b->cur->spans[b->cur->len++];
+    s->name = name;
+    s->t0_ns = t0_ns;
+    s->dur_ns = t1_ns - t0_ns;
+}
+
+static void trace_thread_name(const char *name)
+{
+    TRACE_TLS_NAME = name;
+    if (TRACE_TLS)
+        TRACE_TLS->thread_name = name;
+}
+
+// se llama con todos los hilos trazados ya terminados (fin de la ejecución)
+static void trace_export(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
     {
-        opener = 0;
-        *tile_out = take_from_hand(g, 0, 0);
+        perror("fopen trace");
+        return;
     }
-    else
+    int pid = (int)getpid();
+    long n = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    pthread_mutex_lock(&TRACE_MTX);
+    int first = 1;
+    for (trace_buf_t *b = TRACE_BUFS; b; b = b->next)
     {
-        *tile_out = take_from_hand(g, bp, bi);
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, b->tid, b->thread_name);
+        first = 0;
+        for (trace_chunk_t *c = b->head; c; c = c->next)
+            for (int i = 0; i < c->len; i++, n++)
+                fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        c->spans[i].name, pid, b->tid, c->spans[i].t0_ns / 1e3, c->spans[i].dur_ns / 1e3);
     }
+    pthread_mutex_unlock(&TRACE_MTX);
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    printf("[Trazas] %ld intervalos -> %s", n, path);
+    if (atomic_load(&TRACE_DROPPED))
+        printf(" (%ld descartados por el tope)", (long)atomic_load(&TRACE_DROPPED));
+    printf("\n");
+}
 
-    g->train[0] = *tile_out;
-    g->train_len = 1;
-    g->left_end = tile_out->a;
-    g->right_end = tile_out->b;
-    *opener_out = opener;
-    g->turn = (opener + 1) % g->nplayers; // el planificador arrancará aquí
+#define TRACE_BEGIN(v) long long v##_trace_t0 = now_ns()
+#define TRACE_END(v, name) trace_record((name), v##_trace_t0, now_ns())
+#define TRACE_SPAN(name, t0, t1) trace_record((name), (t0), (t1))
+#define TRACE_THREAD(name) trace_thread_name(name)
+#else
+#define TRACE_BEGIN(v) ((void)0)
+#define TRACE_END(v, name) ((void)0)
+#define TRACE_SPAN(name, t0, t1) ((void)0)
+#define TRACE_THREAD(name) ((void)0)
+static void trace_export(const char *path)
+{
+    fprintf(stderr, "[Trazas] compilado sin -DDOMINO_TRACE: no se escribe %s\n", path);
 }
+#endif
 
-/* ===== cola de acciones global ===== */
-typedef enum
+/* ===== locks instrumentados (--lock-stats) =====
+ * MTX_LOCK / MTX_UNLOCK / CV_WAIT sustituyen a las llamadas pthread sobre
+ * los locks del simulador. Cada llamada declara su propio sitio estático
+ * (función, línea y clase de lock: "mesa" agrupa los g->mtx de todas las
+ * mesas). Con --lock-stats cada hilo acumula, por lock (dirección) y sitio,
+ * adquisiciones, adquisiciones con espera, espera y retención en un bloque
+ * propio (sin atómicos compartidos). El bloque se suma al global cuando el
+ * hilo termina; la consola, que no termina, lo vuelca antes de cada lectura.
+ * La tabla de cada hilo empieza con LK_THREAD_KEYS_MIN pares y se duplica al
+ * llenarse: un jugador toca pocos locks y su bloque se queda en ~7 KB. Si la
+ * tabla de un hilo llega a LK_THREAD_KEYS_MAX, o se llena la global, lo que
+ * no cabe se suma al sitio sin distinguir instancia ("otras").
+ * El camino sin espera cuesta un trylock, una búsqueda en la tabla del hilo
+ * y una lectura de reloj; sin la opción, solo una comprobación de
+ * CFG.lock_stats. */
+#define LK_MAX_SITES 96
+#define LK_MAX_HELD 8
+#define LK_THREAD_KEYS_MIN 16    // potencia de 2: pares (lock, sitio) al crear el hilo
+#define LK_THREAD_KEYS_MAX 16384 // tope al crecer (hilos que tocan todas las mesas)
+#define LK_TOTAL_KEYS 65536  // potencia de 2: pares (lock, sitio) en total
+#define LK_TOP_KEYS 10
+
+typedef struct
 {
-    ACT_PLAY,
-    ACT_DRAW,
-    ACT_PASS
-} act_t;
+    const char *cls;
+    const char *func;
+    int line;
+    atomic_int id; // 0 => sin registrar; -1 => tabla de sitios llena
+} lock_site_t;
+
 typedef struct
 {
-    int table_id, player_id;
-    act_t kind;
-    int idx_in_hand; // solo PLAY
-    int side;        // -1 izq, +1 der (PLAY)
-} action_t;
+    long long acquired, contended;
+    long long wait_ns, max_wait_ns, hold_ns;
+    long long cv_waits, cv_wait_ns;
+} lock_site_stats_t;
 
 typedef struct
 {
-    action_t *buf;
-    int head, tail, size, capacity;
-    pthread_mutex_t mtx;
-    pthread_cond_t not_empty;
-} action_queue_t;
+    const pthread_mutex_t *m;
+    int site; // 0 => entrada libre
+    lock_site_stats_t s;
+} lk_entry_t;
 
-static action_queue_t GQ;
-static void q_init(action_queue_t *q)
+typedef struct
 {
-    memset(q, 0, sizeof(*q));
-    q->capacity = ACTION_Q_CAP;
-    q->buf = malloc(sizeof(action_t) * q->capacity);
-    if (!q->buf)
+    lk_entry_t *e; // tabla abierta de cap pares
+    int cap, nkeys;
+    lock_site_stats_t spill[LK_MAX_SITES]; // tabla llena: por sitio, sin instancia
+    struct
     {
-        perror("malloc action queue");
-        exit(1);
-    }
-    pthread_mutex_init(&q->mtx, NULL);
-    pthread_cond_init(&q->not_empty, NULL);
+        pthread_mutex_t *m;
+        lock_site_stats_t *s; // entrada del sitio que lo adquirió
+        long long t0_ns;
+    } held[LK_MAX_HELD];
+    int nheld;
+} lk_thread_t;
+
+static pthread_mutex_t LK_MTX = PTHREAD_MUTEX_INITIALIZER;
+static lock_site_t *LK_SITES[LK_MAX_SITES];
+static int LK_NSITES = 0;
+static lk_entry_t LK_TOTAL[LK_TOTAL_KEYS];
+static int LK_NKEYS = 0;
+static lock_site_stats_t LK_SPILL[LK_MAX_SITES];
+static pthread_key_t LK_KEY;
+static pthread_once_t LK_ONCE = PTHREAD_ONCE_INIT;
+static __thread lk_thread_t *LK_TLS = NULL;
+
+#define LK_SITE(c) {.cls = (c), .func = __func__, .line = __LINE__, .id = 0}
+
+static unsigned lk_hash(const pthread_mutex_t *m, int site)
+{
+    uint64_t h = ((uint64_t)(uintptr_t)m >> 4) * 0x9e3779b97f4a7c15ULL ^ (uint64_t)site * 0xff51afd7ed558ccdULL;
+    return (unsigned)(h >> 32);
 }
-static void q_grow(action_queue_t *q)
+
+// entrada (m, site) de una tabla abierta de cap entradas; NULL si no cabe
+// (se deja un cuarto libre para que las búsquedas terminen pronto)
+static lk_entry_t *lk_find(lk_entry_t *tab, int cap, int *nkeys, const pthread_mutex_t *m, int site)
 {
-    int new_cap = q->capacity * 2;
-    action_t *nbuf = malloc(sizeof(action_t) * new_cap);
-    if (!nbuf)
+    for (unsigned i = lk_hash(m, site) & (unsigned)(cap - 1);; i = (i + 1) & (unsigned)(cap - 1))
     {
-        perror("malloc action queue grow");
-        exit(1);
+        lk_entry_t *e = &tab[i];
+        if (e->site == site && e->m == m)
+            return e;
+        if (e->site != 0)
+            continue;
+        if (*nkeys >= cap / 4 * 3)
+            return NULL;
+        (*nkeys)++;
+        e->m = m;
+        e->site = site;
+        return e;
     }
-    for (int i = 0; i < q->size; i++)
-        nbuf[i] = q->buf[(q->head + i) % q->capacity];
-    free(q->buf);
-    q->buf = nbuf;
-    q->capacity = new_cap;
-    q->head = 0;
-    q->tail = q->size;
 }
-static void q_push(action_queue_t *q, action_t a)
+
+static void lk_add(lock_site_stats_t *d, const lock_site_stats_t *s)
 {
-    pthread_mutex_lock(&q->mtx);
-    if (q->size == q->capacity)
-        q_grow(q);
-    q->buf[q->tail] = a;
-    q->tail = (q->tail + 1) % q->capacity;
-    q->size++;
-    pthread_cond_signal(&q->not_empty);
-    pthread_mutex_unlock(&q->mtx);
+    d->acquired += s->acquired;
+    d->contended += s->contended;
+    d->wait_ns += s->wait_ns;
+    d->hold_ns += s->hold_ns;
+    d->cv_waits += s->cv_waits;
+    d->cv_wait_ns += s->cv_wait_ns;
+    if (s->max_wait_ns > d->max_wait_ns)
+        d->max_wait_ns = s->max_wait_ns;
 }
-static int q_pop(action_queue_t *q, action_t *out)
+
+// suma el bloque del hilo al global y lo deja a cero; las claves se
+// conservan porque held[] apunta a ellas
+static void lk_merge(lk_thread_t *t)
 {
-    int ok = 0;
-    pthread_mutex_lock(&q->mtx);
-    if (q->size > 0)
+    pthread_mutex_lock(&LK_MTX);
+    for (int i = 0; i < t->cap; i++)
     {
-        *out = q->buf[q->head];
-        q->head = (q->head + 1) % q->capacity;
-        q->size--;
-        ok = 1;
+        lk_entry_t *e = &t->e[i];
+        if (e->site == 0)
+            continue;
+        lk_entry_t *d = lk_find(LK_TOTAL, LK_TOTAL_KEYS, &LK_NKEYS, e->m, e->site);
+        lk_add(d ? &d->s : &LK_SPILL[e->site], &e->s);
+        memset(&e->s, 0, sizeof(e->s));
     }
-    pthread_mutex_unlock(&q->mtx);
-    return ok;
-}
-static void q_destroy(action_queue_t *q)
-{
-    pthread_mutex_destroy(&q->mtx);
-    pthread_cond_destroy(&q->not_empty);
-    free(q->buf);
+    for (int i = 1; i <= LK_NSITES && i < LK_MAX_SITES; i++)
+        lk_add(&LK_SPILL[i], &t->spill[i]);
+    pthread_mutex_unlock(&LK_MTX);
+    memset(t->spill, 0, sizeof(t->spill));
 }
 
-/* ===== cola de cambios de política / quantum ===== */
-typedef struct
+static void lk_thread_exit(void *p)
 {
-    int table_id;
-    int change_policy;
-    policy_t new_policy;
-    int change_quantum;
-    int new_quantum_ms;
-} policy_change_t;
+    lk_thread_t *t = (lk_thread_t *)p;
+    lk_merge(t);
+    free(t->e);
+    free(t);
+}
 
-typedef struct
+// vuelca lo acumulado por el hilo que llama sin esperar a que termine (hilos
+// que no terminan, como la consola)
+static void lk_flush(void)
 {
-    policy_change_t *buf;
-    int head, tail, size, capacity;
-    int stop;
-    pthread_mutex_t mtx;
-    pthread_cond_t not_empty;
-} policy_queue_t;
+    if (CFG.lock_stats && LK_TLS)
+        lk_merge(LK_TLS);
+}
 
-static policy_queue_t POLICY_Q;
+static void lk_key_init(void) { pthread_key_create(&LK_KEY, lk_thread_exit); }
 
-static void policy_q_init(policy_queue_t *q)
+static lk_thread_t *lk_thread(void)
 {
-    memset(q, 0, sizeof(*q));
-    q->capacity = 32;
-    q->buf = malloc(sizeof(policy_change_t) * q->capacity);
-    if (!q->buf)
+    if (LK_TLS)
+        return LK_TLS;
+    pthread_once(&LK_ONCE, lk_key_init);
+    lk_thread_t *t = calloc(1, sizeof(*t));
+    if (t)
+        t->e = calloc(LK_THREAD_KEYS_MIN, sizeof(lk_entry_t));
+    if (!t || !t->e)
     {
-        perror("malloc policy queue");
+        perror("calloc lock stats");
         exit(1);
     }
-    pthread_mutex_init(&q->mtx, NULL);
-    pthread_cond_init(&q->not_empty, NULL);
+    t->cap = LK_THREAD_KEYS_MIN;
+    pthread_setspecific(LK_KEY, t);
+    LK_TLS = t;
+    return t;
 }
 
-static void policy_q_grow(policy_queue_t *q)
+// duplica la tabla del hilo; held[] apunta a entradas viejas y se reengancha
+static int lk_grow(lk_thread_t *t)
 {
-    int new_cap = q->capacity * 2;
-    policy_change_t *nbuf = malloc(sizeof(policy_change_t) * new_cap);
-    if (!nbuf)
+    if (t->cap >= LK_THREAD_KEYS_MAX)
+        return 0;
+    int cap = t->cap * 2, nkeys = 0;
+    lk_entry_t *e = calloc(cap, sizeof(lk_entry_t));
+    if (!e)
+        return 0; // sin memoria: lo nuevo va a "otras"
+    for (int i = 0; i < t->cap; i++)
     {
-        perror("malloc policy queue grow");
-        exit(1);
+        if (t->e[i].site == 0)
+            continue;
+        lk_entry_t *d = lk_find(e, cap, &nkeys, t->e[i].m, t->e[i].site);
+        d->s = t->e[i].s;
+        for (int h = 0; h < t->nheld; h++)
+            if (t->held[h].s == &t->e[i].s)
+                t->held[h].s = &d->s;
     }
-    for (int i = 0; i < q->size; i++)
-        nbuf[i] = q->buf[(q->head + i) % q->capacity];
-    free(q->buf);
-    q->buf = nbuf;
-    q->capacity = new_cap;
-    q->head = 0;
-    q->tail = q->size;
+    free(t->e);
+    t->e = e;
+    t->cap = cap;
+    t->nkeys = nkeys;
+    return 1;
 }
 
-static void policy_q_push(policy_queue_t *q, policy_change_t ch)
+static lock_site_stats_t *lk_stats(lk_thread_t *t, const pthread_mutex_t *m, int site)
 {
-    pthread_mutex_lock(&q->mtx);
-    if (q->stop)
+    lk_entry_t *e = lk_find(t->e, t->cap, &t->nkeys, m, site);
+    if (!e && lk_grow(t))
+        e = lk_find(t->e, t->cap, &t->nkeys, m, site);
+    return e ? &e->s : &t->spill[site];
+}
+
+static int lk_site_id(lock_site_t *site)
+{
+    int id = atomic_load_explicit(&site->id, memory_order_acquire);
+    if (id != 0)
+        return id;
+    pthread_mutex_lock(&LK_MTX);
+    id = atomic_load_explicit(&site->id, memory_order_relaxed);
+    if (id == 0)
     {
-        pthread_mutex_unlock(&q->mtx);
-        return;
+        id = (LK_NSITES + 1 < LK_MAX_SITES) ? ++LK_NSITES : -1;
+        if (id > 0)
+            LK_SITES[id] = site;
+        atomic_store_explicit(&site->id, id, memory_order_release);
     }
-    if (q->size == q->capacity)
-        policy_q_grow(q);
-    q->buf[q->tail] = ch;
-    q->tail = (q->tail + 1) % q->capacity;
-    q->size++;
-    pthread_cond_signal(&q->not_empty);
-    pthread_mutex_unlock(&q->mtx);
+    pthread_mutex_unlock(&LK_MTX);
+    return id;
 }
 
-static int policy_q_try_pop(policy_queue_t *q, policy_change_t *out)
+static void lk_held_push(lk_thread_t *t, pthread_mutex_t *m, lock_site_stats_t *s, long long now)
 {
-    int ret = 0;
-    pthread_mutex_lock(&q->mtx);
-    if (q->size > 0)
+    if (t->nheld == LK_MAX_HELD)
+        return; // anidamiento anómalo: no se mide la retención
+    t->held[t->nheld].m = m;
+    t->held[t->nheld].s = s;
+    t->held[t->nheld].t0_ns = now;
+    t->nheld++;
+}
+
+// cierra la retención de m; devuelve las estadísticas de quien lo adquirió (NULL si no consta)
+static lock_site_stats_t *lk_held_pop(lk_thread_t *t, pthread_mutex_t *m, long long now)
+{
+    for (int i = t->nheld - 1; i >= 0; i--)
     {
-        *out = q->buf[q->head];
-        q->head = (q->head + 1) % q->capacity;
-        q->size--;
-        ret = 1;
+        if (t->held[i].m != m)
+            continue;
+        lock_site_stats_t *s = t->held[i].s;
+        s->hold_ns += now - t->held[i].t0_ns;
+        t->held[i] = t->held[--t->nheld];
+        return s;
     }
-    else if (q->stop)
+    return NULL;
+}
+
+static void lk_lock(pthread_mutex_t *m, lock_site_t *site)
+{
+    if (!CFG.lock_stats)
     {
-        ret = -1;
+        pthread_mutex_lock(m);
+        return;
     }
-    pthread_mutex_unlock(&q->mtx);
-    return ret;
+    int id = lk_site_id(site);
+    if (id < 0)
+    {
+        pthread_mutex_lock(m);
+        return;
+    }
+    lk_thread_t *t = lk_thread();
+    lock_site_stats_t *s = lk_stats(t, m, id);
+    long long now;
+    if (pthread_mutex_trylock(m) == 0)
+        now = now_ns();
+    else
+    {
+        long long t0 = now_ns();
+        pthread_mutex_lock(m);
+        now = now_ns();
+        long long w = now - t0;
+        s->contended++;
+        s->wait_ns += w;
+        if (w > s->max_wait_ns)
+            s->max_wait_ns = w;
+    }
+    s->acquired++;
+    lk_held_push(t, m, s, now);
 }
 
-static void policy_q_stop(policy_queue_t *q)
+static void lk_unlock(pthread_mutex_t *m)
 {
-    pthread_mutex_lock(&q->mtx);
-    q->stop = 1;
-    pthread_cond_broadcast(&q->not_empty);
-    pthread_mutex_unlock(&q->mtx);
+    if (CFG.lock_stats && LK_TLS)
+        lk_held_pop(LK_TLS, m, now_ns());
+    pthread_mutex_unlock(m);
 }
 
-static void policy_q_destroy(policy_queue_t *q)
+static void lk_cond_wait(pthread_cond_t *cv, pthread_mutex_t *m, const struct timespec *abstime)
 {
-    pthread_mutex_destroy(&q->mtx);
-    pthread_cond_destroy(&q->not_empty);
-    free(q->buf);
+    if (abstime)
+        pthread_cond_timedwait(cv, m, abstime);
+    else
+        pthread_cond_wait(cv, m);
 }
 
-static void request_policy_change(int table_id, policy_t newp)
+// la retención se corta durante la espera; al despertar sigue contando para
+// el sitio que adquirió el lock, y la espera (incluida la readquisición) se
+// anota en el sitio del CV_WAIT / CV_TIMEDWAIT
+static void lk_cv_wait(pthread_cond_t *cv, pthread_mutex_t *m, const struct timespec *abstime, lock_site_t *site)
 {
-    policy_change_t ch = {
-        .table_id = table_id,
-        .change_policy = 1,
-        .new_policy = newp,
-        .change_quantum = 0,
-        .new_quantum_ms = 0,
-    };
-    policy_q_push(&POLICY_Q, ch);
+    int id;
+    if (!CFG.lock_stats || !LK_TLS || (id = lk_site_id(site)) < 0)
+    {
+        lk_cond_wait(cv, m, abstime);
+        return;
+    }
+    lk_thread_t *t = LK_TLS;
+    long long t0 = now_ns();
+    lock_site_stats_t *owner = lk_held_pop(t, m, t0);
+    lk_cond_wait(cv, m, abstime);
+    long long now = now_ns();
+    lock_site_stats_t *s = lk_stats(t, m, id);
+    s->cv_waits++;
+    s->cv_wait_ns += now - t0;
+    if (owner)
+        lk_held_push(t, m, owner, now);
 }
 
-static int evaluate_auto_policy(game_state_t *g, policy_t *next_out)
-{
-    if (g->nplayers <= 0)
-        return 0;
+#define MTX_LOCK(m, cls)                            \
+    do                                              \
+    {                                               \
+        static lock_site_t lk_site_ = LK_SITE(cls); \
+        lk_lock((m), &lk_site_);                    \
+    } while (0)
+#define MTX_UNLOCK(m) lk_unlock(m)
+#define CV_WAIT(cv, m) CV_TIMEDWAIT(cv, m, NULL)
+#define CV_TIMEDWAIT(cv, m, abstime)                 \
+    do                                               \
+    {                                                \
+        static lock_site_t lk_site_ = LK_SITE(NULL); \
+        lk_cv_wait((cv), (m), (abstime), &lk_site_); \
+    } while (0)
 
-    int min_tiles = INT_MAX, max_tiles = 0;
-    int min_points = INT_MAX, max_points = 0;
+static lock_site_stats_t LK_BY_SITE[LK_MAX_SITES]; // informe: agregado por sitio
 
-    for (int p = 0; p < g->nplayers; ++p)
-    {
-        int tiles = g->hand_len[p];
-        if (tiles < min_tiles)
-            min_tiles = tiles;
-        if (tiles > max_tiles)
-            max_tiles = tiles;
+static int lk_cmp_wait(const void *a, const void *b)
+{
+    long long wa = LK_BY_SITE[*(const int *)a].wait_ns, wb = LK_BY_SITE[*(const int *)b].wait_ns;
+    return (wa < wb) - (wa > wb);
+}
 
-        int pts = hand_points(g, p);
-        if (pts < min_points)
-            min_points = pts;
-        if (pts > max_points)
-            max_points = pts;
-    }
+static int lk_cmp_key_wait(const void *a, const void *b)
+{
+    long long wa = LK_TOTAL[*(const int *)a].s.wait_ns, wb = LK_TOTAL[*(const int *)b].s.wait_ns;
+    return (wa < wb) - (wa > wb);
+}
 
-    int tile_gap = max_tiles - min_tiles;
-    int point_gap = max_points - min_points;
+// informe ordenado por espera total; incluye el hilo que llama
+static void lock_stats_report(void)
+{
+    if (!CFG.lock_stats)
+        return;
+    lk_flush();
+    pthread_mutex_lock(&LK_MTX);
+    int n = LK_NSITES;
+    int order[LK_MAX_SITES];
 
-    if (g->pass_streak >= g->nplayers && g->policy != RR)
-    {
-        *next_out = RR;
-        return 1;
-    }
+    // por sitio: todas las instancias más lo que no cupo ("otras")
+    memcpy(LK_BY_SITE, LK_SPILL, sizeof(LK_BY_SITE));
+    int *keys = malloc(sizeof(int) * LK_TOTAL_KEYS);
+    int nkeys = 0;
+    for (int i = 0; i < LK_TOTAL_KEYS; i++)
+        if (LK_TOTAL[i].site != 0)
+        {
+            lk_add(&LK_BY_SITE[LK_TOTAL[i].site], &LK_TOTAL[i].s);
+            if (keys)
+                keys[nkeys++] = i;
+        }
 
-    if (tile_gap >= 3 && g->policy != SJF_PLAYERS)
+    // por clase: agrega los sitios de adquisición (CV_WAIT no tiene clase)
+    printf("[Locks] %-10s %12s %11s %12s %11s %13s %10s\n", "clase", "adquis.", "con espera", "espera ms",
+           "máx us", "retención ms", "media ns");
+    const char *seen[LK_MAX_SITES];
+    int nseen = 0;
+    for (int i = 1; i <= n; i++)
     {
-        *next_out = SJF_PLAYERS;
-        return 1;
+        const char *cls = LK_SITES[i]->cls;
+        int dup = !cls;
+        for (int k = 0; k < nseen && !dup; k++)
+            dup = strcmp(seen[k], cls) == 0;
+        if (dup)
+            continue;
+        seen[nseen++] = cls;
+        lock_site_stats_t a = {0};
+        for (int j = i; j <= n; j++)
+        {
+            if (!LK_SITES[j]->cls || strcmp(LK_SITES[j]->cls, cls) != 0)
+                continue;
+            lock_site_stats_t *s = &LK_BY_SITE[j];
+            a.acquired += s->acquired;
+            a.contended += s->contended;
+            a.wait_ns += s->wait_ns;
+            a.hold_ns += s->hold_ns;
+            if (s->max_wait_ns > a.max_wait_ns)
+                a.max_wait_ns = s->max_wait_ns;
+        }
+        printf("[Locks] %-10s %12lld %10.2f%% %12.2f %11.1f %13.2f %10.0f\n", cls, a.acquired,
+               a.acquired ? 100.0 * a.contended / a.acquired : 0.0, a.wait_ns / 1e6, a.max_wait_ns / 1e3,
+               a.hold_ns / 1e6, a.acquired ? (double)a.hold_ns / a.acquired : 0.0);
     }
 
-    if (point_gap >= 12 && g->policy != SJF_POINTS)
+    // por sitio, de mayor a menor espera
+    for (int i = 0; i < n; i++)
+        order[i] = i + 1;
+    qsort(order, n, sizeof(int), lk_cmp_wait);
+    printf("[Locks] sitios por espera total:\n");
+    printf("[Locks]   %-32s %-9s %11s %10s %12s %11s %13s %11s\n", "sitio", "clase", "adquis.",
+           "con espera", "espera ms", "máx us", "retención ms", "cv ms");
+    for (int k = 0; k < n; k++)
     {
-        *next_out = SJF_POINTS;
-        return 1;
+        lock_site_t *st = LK_SITES[order[k]];
+        lock_site_stats_t *s = &LK_BY_SITE[order[k]];
+        if (s->acquired == 0 && s->cv_waits == 0)
+            continue;
+        char where[64];
+        snprintf(where, sizeof(where), "%s:%d", st->func, st->line);
+        printf("[Locks]   %-32s %-9s %11lld %10lld %12.2f %11.1f %13.2f %11.2f\n", where, st->cls ? st->cls : "(cv)",
+               s->acquired, s->contended, s->wait_ns / 1e6, s->max_wait_ns / 1e3, s->hold_ns / 1e6,
+               s->cv_wait_ns / 1e6);
     }
 
-    if (g->policy == SJF_POINTS && tile_gap >= 3)
+    // por instancia: los pares (lock, sitio) con más espera
+    if (keys)
     {
-        *next_out = SJF_PLAYERS;
-        return 1;
+        qsort(keys, nkeys, sizeof(int), lk_cmp_key_wait);
+        long long spilled = 0;
+        for (int i = 1; i <= n; i++)
+            spilled += LK_SPILL[i].acquired;
+        printf("[Locks] locks por espera total (%d pares lock/sitio, %lld adquisiciones en \"otras\"):\n", nkeys,
+               spilled);
+        printf("[Locks]   %-18s %-32s %-9s %11s %10s %12s %11s %13s\n", "lock", "sitio", "clase", "adquis.",
+               "con espera", "espera ms", "máx us", "retención ms");
+        for (int k = 0; k < nkeys && k < LK_TOP_KEYS; k++)
+        {
+            const lk_entry_t *e = &LK_TOTAL[keys[k]];
+            if (e->s.wait_ns == 0)
+                break;
+            lock_site_t *st = LK_SITES[e->site];
+            char where[64];
+            snprintf(where, sizeof(where), "%s:%d", st->func, st->line);
+            printf("[Locks]   %-18p %-32s %-9s %11lld %10lld %12.2f %11.1f %13.2f\n", (const void *)e->m, where,
+                   st->cls ? st->cls : "(cv)", e->s.acquired, e->s.contended, e->s.wait_ns / 1e6,
+                   e->s.max_wait_ns / 1e3, e->s.hold_ns / 1e6);
+        }
+        free(keys);
     }
+    pthread_mutex_unlock(&LK_MTX);
+}
 
-    if (g->policy == SJF_PLAYERS && point_gap >= 12)
-    {
-        *next_out = SJF_POINTS;
-        return 1;
-    }
+/* ===== rueda de temporizadores jerárquica =====
+ * Un solo hilo atiende todos los plazos (inicio de turno tras el cooldown,
+ * vencimiento del quantum RR). 4 niveles de 64 ranuras con tic de 100 us:
+ * el nivel 0 cubre 6.4 ms, el 1 ~410 ms, el 2 ~26 s y el 3 ~28 min (más
+ * lejos se satura). Armar y cancelar son O(1): listas doblemente enlazadas
+ * por ranura. Al dar la vuelta el nivel 0 se redistribuyen ("cascada") los
+ * temporizadores de la ranura que toca del nivel superior.
+ *
+ * Las retrollamadas corren en el hilo de la rueda sin W.mtx tomado, así que
+ * pueden tomar g->mtx; quien arma o cancela con g->mtx tomado solo toma
+ * W.mtx (orden g->mtx -> W.mtx). Un temporizador vencido espera en la lista
+ * local de vencidos (TIMER_FIRING) hasta que le toca; armarlo o cancelarlo
+ * mientras tanto lo saca de esa lista, así que nunca está en dos listas.
+ * timer_cancel_sync además espera a que termine una retrollamada en curso
+ * (no llamarla con locks que esta use).
+ */
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_TICK_NS 100000LL
 
-    if (g->policy != FCFS && tile_gap <= 1 && point_gap <= 6 && g->pass_streak == 0)
-    {
-        *next_out = FCFS;
-        return 1;
-    }
+static struct
+{
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;   // hay un plazo más cercano o hay que parar
+    pthread_cond_t done; // terminó una retrollamada (timer_cancel_sync)
+    wheel_timer_t slot[WHEEL_LEVELS][WHEEL_SLOTS]; // cabeceras (listas circulares)
+    uint64_t tick;       // último tic procesado
+    long long t0_ns;
+    long armed;          // temporizadores en la rueda
+    wheel_timer_t *running;
+    int stop;
+    pthread_t th;
 
-    if (g->policy == RR && g->pass_streak == 0 && tile_gap >= 3)
-    {
-        *next_out = SJF_PLAYERS;
-        return 1;
-    }
+    long n_armed, n_fired, n_cancelled; // contadores de la ejecución
+} W;
+static atomic_long QUANTUM_EXPIRED; // turnos RR que agotaron el quantum
 
-    return 0;
+static uint64_t wheel_now_tick(void) { return (uint64_t)((now_ns() - W.t0_ns) / WHEEL_TICK_NS); }
+
+static void wheel_link(wheel_timer_t *t)
+{
+    uint64_t delta = t->expires - W.tick;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1))))
+        level++;
+    if (delta >= (1ULL << (WHEEL_BITS * WHEEL_LEVELS)))
+        t->expires = W.tick + (1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1; // saturar
+    wheel_timer_t *head = &W.slot[level][(t->expires >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    t->prev = head->prev;
+    t->next = head;
+    head->prev->next = t;
+    head->prev = t;
 }
 
-static int supervisor_apply_policy_change(game_state_t *g, policy_t new_policy, const char *reason)
+static void wheel_unlink(wheel_timer_t *t)
 {
-    if (g->policy == new_policy)
-        return 0;
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
 
-    policy_t old = g->policy;
-    g->policy = new_policy;
-    printf(">> Supervisor%s: Mesa %d cambia política %s -> %s\n",
-           reason ? reason : "", g->table_id, policy_name(old), policy_name(new_policy));
-    fflush(stdout);
-    pthread_cond_broadcast(&g->cv);
-    return 1;
+// vacía una ranura y vuelve a colocar sus temporizadores (un nivel más abajo)
+static void wheel_cascade(int level, int idx)
+{
+    wheel_timer_t *head = &W.slot[level][idx];
+    while (head->next != head)
+    {
+        wheel_timer_t *t = head->next;
+        wheel_unlink(t);
+        wheel_link(t);
+    }
 }
 
-/* ===== búsqueda de jugada posible ===== */
-static int find_play(game_state_t *g, int pid, int *idx_out, int *side_out)
+// vencido pero aún en la lista local de wheel_thread esperando su turno (con W.mtx)
+static int timer_pending_fire(wheel_timer_t *t) { return t->state == TIMER_FIRING && t != W.running; }
+
+// arma (o rearma) t para dentro de delay_ns; si t venció y su retrollamada aún
+// no empezó, se saca de la lista de vencidos y ese disparo se descarta
+static void timer_arm(wheel_timer_t *t, long long delay_ns, void (*fn)(void *), void *arg)
 {
-    // Primero buscar en extremo izquierdo
-    for (int i = 0; i < g->hand_len[pid]; i++)
+    MTX_LOCK(&W.mtx, "rueda");
+    if (t->state == TIMER_ARMED)
     {
-        tile_t t = g->hands[pid][i];
-        if (t.a == g->left_end || t.b == g->left_end)
-        {
-            *idx_out = i;
-            *side_out = -1;
-            return 1;
-        }
+        wheel_unlink(t);
+        W.armed--;
     }
-    // Luego en extremo derecho
-    for (int i = 0; i < g->hand_len[pid]; i++)
+    else if (timer_pending_fire(t))
     {
-        tile_t t = g->hands[pid][i];
-        if (t.a == g->right_end || t.b == g->right_end)
-        {
-            *idx_out = i;
-            *side_out = +1;
-            return 1;
-        }
+        wheel_unlink(t);
+        W.n_cancelled++;
     }
-    return 0;
+    if (W.armed == 0) // rueda vacía: saltar el tiempo ocioso en vez de recorrerlo
+    {
+        uint64_t now = wheel_now_tick();
+        if (now > W.tick)
+            W.tick = now;
+    }
+    // primer tic que empieza en o después del plazo: nunca se dispara antes
+    long long due_ns = now_ns() - W.t0_ns + (delay_ns > 0 ? delay_ns : 0);
+    t->expires = (uint64_t)((due_ns + WHEEL_TICK_NS - 1) / WHEEL_TICK_NS);
+    if (t->expires <= W.tick)
+        t->expires = W.tick + 1;
+    t->fn = fn;
+    t->arg = arg;
+    t->state = TIMER_ARMED;
+    wheel_link(t);
+    W.armed++;
+    W.n_armed++;
+    pthread_cond_signal(&W.cv);
+    MTX_UNLOCK(&W.mtx);
 }
 
-/* ===== jugadores (productores) ===== */
-typedef struct
+// 1 si lo quitó de la rueda antes de dispararse
+static int timer_cancel(wheel_timer_t *t)
 {
-    game_state_t *g;
-    int pid;
-} player_args_t;
+    int ok = 0;
+    MTX_LOCK(&W.mtx, "rueda");
+    if (t->state == TIMER_ARMED || timer_pending_fire(t))
+    {
+        wheel_unlink(t);
+        if (t->state == TIMER_ARMED)
+            W.armed--;
+        t->state = TIMER_IDLE;
+        W.n_cancelled++;
+        ok = 1;
+    }
+    MTX_UNLOCK(&W.mtx);
+    return ok;
+}
 
-void *player_thread(void *arg)
+static void timer_cancel_sync(wheel_timer_t *t)
 {
-    player_args_t *pa = (player_args_t *)arg;
-    game_state_t *g = pa->g;
-    int pid = pa->pid;
-    free(pa);
+    timer_cancel(t);
+    MTX_LOCK(&W.mtx, "rueda");
+    while (t->state == TIMER_FIRING)
+        CV_WAIT(&W.done, &W.mtx);
+    MTX_UNLOCK(&W.mtx);
+}
 
-    for (;;)
+// siguiente tic con trabajo: ranura ocupada del nivel 0 o la próxima cascada
+static uint64_t wheel_next_tick(void)
+{
+    uint64_t t = W.tick + 1;
+    for (; (t & WHEEL_MASK) != 0; t++)
     {
-        pthread_mutex_lock(&g->mtx);
-        while (!g->finished && g->turn != pid)
-            pthread_cond_wait(&g->cv, &g->mtx);
-        if (g->finished)
-        {
-            pthread_mutex_unlock(&g->mtx);
-            break;
-        }
-
-        // cooldown al inicio del turno planificado
-        int cooldown_ms = g->turn_cooldown_ms;
-        pthread_mutex_unlock(&g->mtx);
-        sleep_ms(cooldown_ms);
-        pthread_mutex_lock(&g->mtx);
+        wheel_timer_t *head = &W.slot[0][t & WHEEL_MASK];
+        if (head->next != head)
+            return t;
+    }
+    return t;
+}
 
-        if (g->finished)
+void *wheel_thread(void *arg)
+{
+    (void)arg;
+    TRACE_THREAD("rueda");
+    MTX_LOCK(&W.mtx, "rueda");
+    while (!W.stop)
+    {
+        if (W.armed == 0)
         {
-            pthread_mutex_unlock(&g->mtx);
-            break;
+            CV_WAIT(&W.cv, &W.mtx);
+            continue;
         }
-        if (g->turn != pid)
+        uint64_t now = wheel_now_tick();
+        if (now <= W.tick)
         {
-            pthread_mutex_unlock(&g->mtx);
+            long long wake_ns = W.t0_ns + (long long)wheel_next_tick() * WHEEL_TICK_NS;
+            struct timespec ts = {.tv_sec = wake_ns / 1000000000LL, .tv_nsec = wake_ns % 1000000000LL};
+            CV_TIMEDWAIT(&W.cv, &W.mtx, &ts);
             continue;
         }
 
-        // decidir 1 acción
-        action_t planned = {.table_id = g->table_id, .player_id = pid};
-        int idx = -1, side = 0;
-        if (find_play(g, pid, &idx, &side))
-        {
-            planned.kind = ACT_PLAY;
-            planned.idx_in_hand = idx;
-            planned.side = side;
-        }
-        else if (g->pool_len > 0)
+        // avanzar tic a tic hasta ahora, recogiendo los vencidos
+        wheel_timer_t fired = {.next = &fired, .prev = &fired};
+        while (W.tick < now)
         {
-            planned.kind = ACT_DRAW;
+            W.tick++;
+            uint64_t tk = W.tick;
+            for (int level = 1; level < WHEEL_LEVELS && (tk & WHEEL_MASK) == 0; level++)
+            {
+                tk >>= WHEEL_BITS;
+                wheel_cascade(level, (int)(tk & WHEEL_MASK));
+            }
+            wheel_timer_t *head = &W.slot[0][W.tick & WHEEL_MASK];
+            while (head->next != head)
+            {
+                wheel_timer_t *t = head->next;
+                wheel_unlink(t);
+                t->prev = fired.prev;
+                t->next = &fired;
+                fired.prev->next = t;
+                fired.prev = t;
+                t->state = TIMER_FIRING;
+                W.armed--;
+            }
         }
-        else
+        while (fired.next != &fired)
         {
-            planned.kind = ACT_PASS;
+            wheel_timer_t *t = fired.next;
+            wheel_unlink(t);
+            W.running = t;
+            MTX_UNLOCK(&W.mtx);
+            t->fn(t->arg);
+            MTX_LOCK(&W.mtx, "rueda");
+            W.running = NULL;
+            if (t->state == TIMER_FIRING) // la retrollamada pudo rearmarlo
+                t->state = TIMER_IDLE;
+            W.n_fired++;
+            pthread_cond_broadcast(&W.done);
         }
-
-        q_push(&GQ, planned);
-
-        // esperar a que el validador aplique (cerrando el "turno planificado")
-        while (!g->finished && !g->action_done)
-            pthread_cond_wait(&g->cv, &g->mtx);
-        pthread_mutex_unlock(&g->mtx);
     }
+    MTX_UNLOCK(&W.mtx);
     return NULL;
 }
 
-/* ===== validador (consumidor) ===== */
-typedef struct
+static void timers_start(void)
 {
-    game_state_t *tables;
-    int n_tables;
-} validator_args_t;
+    pthread_mutex_init(&W.mtx, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&W.cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_cond_init(&W.done, NULL);
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        for (int s = 0; s < WHEEL_SLOTS; s++)
+            W.slot[l][s].next = W.slot[l][s].prev = &W.slot[l][s];
+    W.t0_ns = now_ns();
+    W.tick = 0;
+    W.armed = W.n_armed = W.n_fired = W.n_cancelled = 0;
+    W.running = NULL;
+    W.stop = 0;
+    if (pthread_create(&W.th, NULL, wheel_thread, NULL) != 0)
+    {
+        perror("pthread_create(rueda)");
+        exit(1);
+    }
+}
 
-static int all_tables_finished(game_state_t *t, int n)
+static void timers_stop(void)
 {
-    for (int i = 0; i < n; i++)
-        if (!t[i].finished)
-            return 0;
-    return 1;
+    MTX_LOCK(&W.mtx, "rueda");
+    W.stop = 1;
+    pthread_cond_signal(&W.cv);
+    MTX_UNLOCK(&W.mtx);
+    pthread_join(W.th, NULL);
+    pthread_mutex_destroy(&W.mtx);
+    pthread_cond_destroy(&W.cv);
+    pthread_cond_destroy(&W.done);
 }
 
-static void apply_play(game_state_t *g, int pid, int idx, int side)
+/* ===== publicación / lectura de instantáneas ===== */
+// requiere g->mtx: un solo escritor por mesa
+static void snapshot_publish(game_state_t *g)
 {
-    tile_t t = take_from_hand(g, pid, idx);
-    if (side < 0)
+    table_snapshot_t *sn = &g->snap;
+    unsigned seq = atomic_load_explicit(&sn->seq, memory_order_relaxed);
+    atomic_store_explicit(&sn->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    table_summary_t *s = &sn->s;
+    s->nplayers = g->nplayers;
+    s->turn = g->turn;
+    s->left_end = g->left_end;
+    s->right_end = g->right_end;
+    for (int p = 0; p < g->nplayers; p++)
     {
-        for (int i = g->train_len; i > 0; i--)
-            g->train[i] = g->train[i - 1];
-        g->train[0] = t;
-        g->train_len++;
-        if (t.a == g->left_end)
-            g->left_end = t.b;
-        else if (t.b == g->left_end)
-            g->left_end = t.a;
+        s->hand_len[p] = g->hand_len[p];
+        s->points[p] = hand_points(g, p);
     }
-    else
+    s->pool_len = g->pool_len;
+    s->pass_streak = g->pass_streak;
+    s->steps = g->steps;
+    s->finished = g->finished;
+    s->policy = g->policy;
+    s->rr_quantum_ms = g->rr_quantum_ms;
+    s->turn_cooldown_ms = g->turn_cooldown_ms;
+
+    atomic_store_explicit(&sn->seq, seq + 2, memory_order_release);
+}
+
+// lectura sin bloqueo: nunca frena al escritor
+static void snapshot_read(game_state_t *g, table_summary_t *out)
+{
+    table_snapshot_t *sn = &g->snap;
+    for (;;)
     {
-        g->train[g->train_len++] = t;
-        if (t.a == g->right_end)
-            g->right_end = t.b;
-        else if (t.b == g->right_end)
-            g->right_end = t.a;
+        unsigned s1 = atomic_load_explicit(&sn->seq, memory_order_acquire);
+        if (s1 & 1u)
+        {
+            sched_yield();
+            continue;
+        }
+        memcpy(out, &sn->s, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        unsigned s2 = atomic_load_explicit(&sn->seq, memory_order_relaxed);
+        if (s1 == s2)
+            return;
     }
-    g->pass_streak = 0;
-    printf("Mesa %d | J%d JUEGA ", g->table_id, pid);
-    print_tile(t);
-    printf(" en %s -> extremos %d-%d (mano %d)\n", side < 0 ? "izq" : "der", g->left_end, g->right_end, g->hand_len[pid]);
 }
-static void apply_draw(game_state_t *g, int pid)
+
+/* ===== mazo / reparto ===== */
+static void build_deck(tile_t d[MAX_TILES], int *len)
 {
-    if (g->pool_len <= 0)
-        return;
-    tile_t t = g->pool[--g->pool_len];
-    add_to_hand(g, pid, t);
-    printf("Mesa %d | J%d ROBA 1. Pozo=%d, Mano=%d\n", g->table_id, pid, g->pool_len, g->hand_len[pid]);
+    int k = 0;
+    for (int lo = 0; lo <= CFG.pips; lo++)
+        for (int hi = lo; hi <= CFG.pips; hi++)
+            d[k++] = (tile_t)(hi * (hi + 1) / 2 + lo);
+    *len = k;
 }
-static void apply_pass(game_state_t *g, int pid)
+// Fisher–Yates con una extracción de 64 bits por cada dos intercambios: cada
+// mitad de 32 bits se lleva a [0, i] con multiplicación y desplazamiento, sin
+// división (el sesgo, < 91 / 2^32, es despreciable)
+static void shuffle_deck(tile_t d[], int len, rng_t *rng)
 {
-    g->pass_streak++;
-    printf("Mesa %d | J%d PASA. (racha=%d)\n", g->table_id, pid, g->pass_streak);
-    if (g->pool_len == 0 && g->pass_streak >= g->nplayers)
+    uint64_t bits = 0;
+    for (int i = len - 1, k = 0; i > 0; i--, k ^= 1)
     {
-        print_points_table(g);
-        int win = winner_lowest_points(g);
-        printf("=== Mesa %d | CIERRE por bloqueo. Gana J%d ===\n", g->table_id, win);
-        g->finished = 1;
+        if (k == 0)
+            bits = rng_next(rng);
+        uint32_t half = k == 0 ? (uint32_t)bits : (uint32_t)(bits >> 32);
+        int j = (int)(((uint64_t)half * (uint64_t)(i + 1)) >> 32);
+        tile_t t = d[i];
+        d[i] = d[j];
+        d[j] = t;
     }
 }
-
-void *validator_thread(void *arg)
+static void take_from_hand(game_state_t *g, int p, tile_t t)
 {
-    validator_args_t *va = (validator_args_t *)arg;
-    game_state_t *tables = va->tables;
-    int N = va->n_tables;
+    g->hands[p] &= ~TILE_BIT(t);
+    g->hand_len[p]--;
+}
+static void add_to_hand(game_state_t *g, int p, tile_t t)
+{
+    g->hands[p] |= TILE_BIT(t);
+    g->hand_len[p]++;
+}
+// reparto resuelto a partir de la semilla: manos ya sin la ficha de apertura
+typedef struct
+{
+    int32_t idx;   // posición en la fuente de mesas (reparto anticipado)
+    uint32_t seed;
+    tmask_t hands[MAX_PLAYERS];
+    tile_t pool[MAX_POOL]; // se roba desde el final
+    uint8_t nplayers, pool_len, opener;
+    tile_t opening;
+} deal_t;
 
-    for (;;)
-    {
-        action_t act;
-        int have = 0;
-        while (!(have = q_pop(&GQ, &act)))
-        {
-            if (all_tables_finished(tables, N))
-                return NULL;
+static void deal_compute(uint32_t seed, int nplayers, deal_t *d)
+{
+    tile_t deck[MAX_TILES];
+    int len = 0;
+    build_deck(deck, &len);
+    rng_t rng = {.s = seed};
+    shuffle_deck(deck, len, &rng);
+    d->seed = seed;
+    d->nplayers = (uint8_t)nplayers;
+    int idx = 0;
+    for (int p = 0; p < nplayers; p++)
+    {
+        d->hands[p] = 0;
+        for (int c = 0; c < HAND_DEAL; c++)
+            d->hands[p] |= TILE_BIT(deck[idx++]);
+    }
+    d->pool_len = 0;
+    while (idx < len)
+        d->pool[d->pool_len++] = deck[idx++];
+    int opener;
+    ENGINE.opening(d->hands, nplayers, &opener, &d->opening);
+    d->hands[opener] &= ~TILE_BIT(d->opening);
+    d->opener = (uint8_t)opener;
+}
+
+// deja la mesa con la apertura jugada; el planificador arrancará en el siguiente
+static void deal_apply(game_state_t *g, const deal_t *d)
+{
+    for (int p = 0; p < g->nplayers; p++)
+    {
+        g->hands[p] = d->hands[p];
+        g->hand_len[p] = (uint8_t)(HAND_DEAL - (p == d->opener));
+    }
+    g->pool_len = d->pool_len;
+    memcpy(g->pool, d->pool, d->pool_len);
+    g->played = TILE_BIT(d->opening);
+    g->train_len = 1;
+    g->left_end = TILE_LO[d->opening];
+    g->right_end = TILE_HI[d->opening];
+    g->opener = d->opener;
+    g->opening = d->opening;
+    g->turn = (uint8_t)((d->opener + 1) % g->nplayers);
+    g->dealt = 1;
+}
+
+/* ===== cola de acciones global ===== */
+typedef enum
+{
+    ACT_PLAY,
+    ACT_DRAW,
+    ACT_PASS
+} act_t;
+typedef struct
+{
+    int table_id, player_id;
+    act_t kind;
+    tile_t tile;     // solo PLAY
+    int side;        // -1 izq, +1 der (PLAY)
+    long long enq_ns; // instante de encolado (latencia de servicio)
+} action_t;
+
+typedef struct
+{
+    action_t *buf;
+    int head, tail, size, capacity;
+    pthread_mutex_t mtx;
+    pthread_cond_t not_empty;
+} action_queue_t;
+
+static action_queue_t GQ;
+static void q_init(action_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+    q->capacity = CFG.queue_cap;
+    q->buf = malloc(sizeof(action_t) * q->capacity);
+    if (!q->buf)
+    {
+        perror("malloc action queue");
+        exit(1);
+    }
+    pthread_mutex_init(&q->mtx, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+}
+static void q_grow(action_queue_t *q)
+{
+    int new_cap = q->capacity * 2;
+    action_t *nbuf = malloc(sizeof(action_t) * new_cap);
+    if (!nbuf)
+    {
+        perror("malloc action queue grow");
+        exit(1);
+    }
+    for (int i = 0; i < q->size; i++)
+        nbuf[i] = q->buf[(q->head + i) % q->capacity];
+    free(q->buf);
+    q->buf = nbuf;
+    q->capacity = new_cap;
+    q->head = 0;
+    q->tail = q->size;
+}
+static void q_push(action_queue_t *q, action_t a)
+{
+    MTX_LOCK(&q->mtx, "GQ");
+    if (q->size == q->capacity)
+        q_grow(q);
+    a.enq_ns = now_ns();
+    q->buf[q->tail] = a;
+    q->tail = (q->tail + 1) % q->capacity;
+    q->size++;
+    pthread_cond_signal(&q->not_empty);
+    MTX_UNLOCK(&q->mtx);
+}
+// bloquea hasta que haya una acción (1) o hasta que terminen todas las mesas (0)
+static int q_pop(action_queue_t *q, action_t *out)
+{
+    int ok = 0;
+    MTX_LOCK(&q->mtx, "GQ");
+    while (q->size == 0 && !comp_all_done())
+        CV_WAIT(&q->not_empty, &q->mtx);
+    if (q->size > 0)
+    {
+        *out = q->buf[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->size--;
+        ok = 1;
+    }
+    MTX_UNLOCK(&q->mtx);
+    return ok;
+}
+static void q_destroy(action_queue_t *q)
+{
+    pthread_mutex_destroy(&q->mtx);
+    pthread_cond_destroy(&q->not_empty);
+    free(q->buf);
+}
+static int q_depth(action_queue_t *q, int *capacity_out)
+{
+    MTX_LOCK(&q->mtx, "GQ");
+    int d = q->size;
+    if (capacity_out)
+        *capacity_out = q->capacity;
+    MTX_UNLOCK(&q->mtx);
+    return d;
+}
+
+/* ===== seguimiento de finalización =====
+ * live cuenta las mesas lanzadas que aún no terminaron, más una ficha que
+ * run_simulation suelta cuando la fuente ya no da más mesas: cada lanzamiento
+ * suma uno y cada mesa se descuenta al acabar. Comprobar si terminó todo es
+ * una lectura atómica. Al llegar a 0 se abre el latch: se difunde COMP.cv, donde
+ * esperan los hilos periódicos y el recolector, y GQ.not_empty, donde
+ * duerme el validador. Cada descuento difunde COMP.cv para que el recolector
+ * vea la entrada nueva de la cola de finalización.
+ */
+typedef struct
+{
+    atomic_int live;
+    atomic_int running; // mesas con hilo en marcha (tope --max-running)
+    pthread_mutex_t mtx;
+    pthread_cond_t cv; // reloj monotónico
+} completion_t;
+
+static completion_t COMP;
+
+static void comp_init(int n)
+{
+    atomic_store(&COMP.live, n);
+    atomic_store(&COMP.running, 0);
+    pthread_mutex_init(&COMP.mtx, NULL);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&COMP.cv, &ca);
+    pthread_condattr_destroy(&ca);
+}
+
+static void comp_destroy(void)
+{
+    pthread_mutex_destroy(&COMP.mtx);
+    pthread_cond_destroy(&COMP.cv);
+}
+
+static int comp_all_done(void) { return atomic_load_explicit(&COMP.live, memory_order_acquire) == 0; }
+
+// una mesa más por terminar (antes de crear su hilo)
+static void comp_add(void) { atomic_fetch_add_explicit(&COMP.live, 1, memory_order_relaxed); }
+
+// descuenta n mesas terminadas (o la ficha del lanzador); la última abre el latch
+static void comp_release(int n)
+{
+    if (n <= 0)
+        return;
+    int last = atomic_fetch_sub_explicit(&COMP.live, n, memory_order_acq_rel) == n;
+    MTX_LOCK(&COMP.mtx, "fin");
+    pthread_cond_broadcast(&COMP.cv);
+    MTX_UNLOCK(&COMP.mtx);
+    if (last)
+    {
+        MTX_LOCK(&GQ.mtx, "GQ");
+        pthread_cond_broadcast(&GQ.not_empty);
+        MTX_UNLOCK(&GQ.mtx);
+    }
+}
+
+// reserva un hueco de mesa en marcha; con --max-running espera a que termine otra
+static void comp_run_acquire(void)
+{
+    if (CFG.max_running <= 0)
+    {
+        atomic_fetch_add(&COMP.running, 1);
+        return;
+    }
+    MTX_LOCK(&COMP.mtx, "fin");
+    while (atomic_load(&COMP.running) >= CFG.max_running)
+        CV_WAIT(&COMP.cv, &COMP.mtx);
+    atomic_fetch_add(&COMP.running, 1);
+    MTX_UNLOCK(&COMP.mtx);
+}
+
+// espera hasta ms milisegundos o hasta que terminen todas las mesas; 1 => terminaron
+static int comp_wait_ms(int ms)
+{
+    long long deadline = now_ns() + (long long)ms * 1000000LL;
+    struct timespec ts = {.tv_sec = deadline / 1000000000LL, .tv_nsec = deadline % 1000000000LL};
+    MTX_LOCK(&COMP.mtx, "fin");
+    while (!comp_all_done() && now_ns() < deadline)
+        CV_TIMEDWAIT(&COMP.cv, &COMP.mtx, &ts);
+    MTX_UNLOCK(&COMP.mtx);
+    return comp_all_done();
+}
+
+/* ===== contrapresión: controlador de profundidad de cola / latencia =====
+ * El validador informa la latencia de servicio (encolado -> extracción) de
+ * cada acción. Cada bp_tick_ms el controlador suaviza latencia y profundidad
+ * (EWMA) y ajusta dos palancas con AIMD:
+ *   - límite de admisión: acciones en vuelo permitidas en GQ; los jugadores
+ *     esperan un hueco antes de encolar, así GQ no crece sin control. Baja
+ *     ×3/4 en sobrecarga y sube admit_step fijo con holgura;
+ *   - enfriamiento adaptativo, uno por mesa: se suma al cooldown de la mesa
+ *     (lo aplica control_thread). En sobrecarga solo crece en las mesas que
+ *     encolaron más que la media en la ventana, así se frena a las que más
+ *     cargan y no a todas por igual; con holgura se relaja ×3/4.
+ * Bajo BP.mtx solo se hace lo O(1): el validador cuenta por mesa en la
+ * ventana en curso y apunta las mesas que se activan; el tick suaviza,
+ * ajusta la admisión y cambia de ventana. El frenado por mesa se calcula
+ * después, fuera del lock, recorriendo solo las mesas activas en la ventana
+ * cerrada (sobrecarga) o las que tienen enfriamiento (holgura). El
+ * enfriamiento de cada mesa es atómico y control_thread lo lee sin BP.mtx.
+ */
+typedef struct
+{
+    int enabled;
+    int target_ms;
+    int max_cooldown_ms;
+
+    // estado del controlador
+    double ewma_latency_ms;
+    double ewma_depth;
+    int admit_limit;
+    int admit_step;       // apertura aditiva por tick con holgura
+    int n_tables;
+    atomic_int *cooldown_ms; // enfriamiento adaptativo por mesa (ranura); lo escribe el tick
+    long *win_table[2];      // acciones de cada mesa por ventana
+    int *active[2];          // mesas con alguna acción en cada ventana
+    int n_active[2];
+    int win;                 // ventana en curso (BP.mtx); la otra es del tick
+    int *braked;             // mesas con enfriamiento > 0 (solo el tick)
+    uint8_t *is_braked;
+    int n_braked;
+    long overload_ticks;
+
+    // contadores
+    int inflight;          // acciones admitidas aún no extraídas por el validador
+    long admitted, throttled;
+    long win_count;        // ventana actual (se reinicia en cada tick)
+    long long win_lat_ns;
+    long total_count;
+    long long total_lat_ns, max_lat_ns;
+
+    int stop;
+    pthread_mutex_t mtx;
+    pthread_cond_t slot_free;
+} backpressure_t;
+
+static backpressure_t BP;
+
+static void bp_init(int target_ms, int max_cooldown_ms, int n_tables)
+{
+    memset(&BP, 0, sizeof(BP));
+    BP.enabled = target_ms > 0;
+    BP.target_ms = target_ms;
+    BP.max_cooldown_ms = max_cooldown_ms;
+    BP.admit_limit = CFG.queue_cap;
+    BP.admit_step = CFG.queue_cap / 32 > 1 ? CFG.queue_cap / 32 : 1;
+    if (BP.enabled)
+    {
+        BP.n_tables = n_tables;
+        BP.cooldown_ms = calloc(n_tables, sizeof(atomic_int));
+        BP.braked = calloc(n_tables, sizeof(int));
+        BP.is_braked = calloc(n_tables, 1);
+        int ok = BP.cooldown_ms && BP.braked && BP.is_braked;
+        for (int w = 0; w < 2; w++)
+        {
+            BP.win_table[w] = calloc(n_tables, sizeof(long));
+            BP.active[w] = calloc(n_tables, sizeof(int));
+            ok = ok && BP.win_table[w] && BP.active[w];
+        }
+        if (!ok)
+        {
+            perror("calloc(contrapresión)");
+            exit(1);
+        }
+    }
+    pthread_mutex_init(&BP.mtx, NULL);
+    pthread_cond_init(&BP.slot_free, NULL);
+}
+
+// el jugador pide un hueco antes de encolar; bloquea si la cola está en su límite
+static void bp_admit(void)
+{
+    MTX_LOCK(&BP.mtx, "BP");
+    if (BP.enabled && !BP.stop && BP.inflight >= BP.admit_limit)
+    {
+        BP.throttled++;
+        while (!BP.stop && BP.inflight >= BP.admit_limit)
+            CV_WAIT(&BP.slot_free, &BP.mtx);
+    }
+    BP.inflight++;
+    BP.admitted++;
+    MTX_UNLOCK(&BP.mtx);
+}
+
+// hueco sin esperar (acción forzada desde la rueda, que no puede bloquearse)
+static void bp_admit_force(void)
+{
+    MTX_LOCK(&BP.mtx, "BP");
+    BP.inflight++;
+    BP.admitted++;
+    MTX_UNLOCK(&BP.mtx);
+}
+
+// devuelve el hueco sin haber encolado (el turno cambió o la mesa terminó)
+static void bp_cancel(void)
+{
+    MTX_LOCK(&BP.mtx, "BP");
+    BP.inflight--;
+    pthread_cond_signal(&BP.slot_free);
+    MTX_UNLOCK(&BP.mtx);
+}
+
+// el validador extrajo una acción: libera su hueco y registra la latencia
+static void bp_on_dequeue(const action_t *a, long long now)
+{
+    long long lat = now - a->enq_ns;
+    MTX_LOCK(&BP.mtx, "BP");
+    BP.inflight--;
+    BP.win_count++;
+    BP.win_lat_ns += lat;
+    BP.total_count++;
+    BP.total_lat_ns += lat;
+    if (lat > BP.max_lat_ns)
+        BP.max_lat_ns = lat;
+    if (a->table_id >= 0 && a->table_id < BP.n_tables && BP.win_table[BP.win][a->table_id]++ == 0)
+        BP.active[BP.win][BP.n_active[BP.win]++] = a->table_id;
+    pthread_cond_signal(&BP.slot_free);
+    MTX_UNLOCK(&BP.mtx);
+}
+
+static int bp_cooldown_ms(int table_id)
+{
+    if (table_id < 0 || table_id >= BP.n_tables)
+        return 0;
+    return atomic_load_explicit(&BP.cooldown_ms[table_id], memory_order_relaxed);
+}
+
+// la ranura pasa a una mesa nueva: no hereda el frenado de la anterior (sus
+// acciones de la ventana en curso siguen contando para la ranura)
+static void bp_table_reset(int table_id)
+{
+    if (table_id < 0 || table_id >= BP.n_tables)
+        return;
+    atomic_store_explicit(&BP.cooldown_ms[table_id], 0, memory_order_relaxed);
+}
+
+// pasa el enfriamiento de la mesa i de c a c2; si bp_table_reset la puso a
+// cero entretanto, gana el reinicio
+static void bp_set_cooldown(int i, int c, int c2)
+{
+    atomic_compare_exchange_strong_explicit(&BP.cooldown_ms[i], &c, c2, memory_order_relaxed,
+                                            memory_order_relaxed);
+}
+
+// frenado por mesa sobre la ventana w ya cerrada, fuera de BP.mtx: el
+// validador no vuelve a ella hasta el siguiente cambio de ventana, que
+// también hace este hilo. dir > 0: sobrecarga; dir < 0: holgura
+static void bp_adapt_cooldowns(int w, int dir)
+{
+    int *act = BP.active[w], n = BP.n_active[w];
+    long *cnt = BP.win_table[w];
+    if (dir > 0 && n > 0)
+    {
+        // más enfriamiento en las mesas que encolaron por encima de la media
+        int step = BP.target_ms / 2 > 1 ? BP.target_ms / 2 : 1;
+        long total = 0;
+        for (int k = 0; k < n; k++)
+            total += cnt[act[k]];
+        for (int k = 0; k < n; k++)
+        {
+            int i = act[k];
+            if (cnt[i] * n < total)
+                continue;
+            int c = atomic_load_explicit(&BP.cooldown_ms[i], memory_order_relaxed);
+            bp_set_cooldown(i, c, c + step < BP.max_cooldown_ms ? c + step : BP.max_cooldown_ms);
+            if (!BP.is_braked[i])
+            {
+                BP.is_braked[i] = 1;
+                BP.braked[BP.n_braked++] = i;
+            }
+        }
+    }
+    else if (dir < 0)
+    {
+        // relajación: solo las mesas que tienen enfriamiento
+        for (int k = 0; k < BP.n_braked;)
+        {
+            int i = BP.braked[k];
+            int c = atomic_load_explicit(&BP.cooldown_ms[i], memory_order_relaxed);
+            bp_set_cooldown(i, c, c * 3 / 4);
+            if (c * 3 / 4 > 0)
+            {
+                k++;
+                continue;
+            }
+            BP.is_braked[i] = 0;
+            BP.braked[k] = BP.braked[--BP.n_braked];
+        }
+    }
+    for (int k = 0; k < n; k++)
+        cnt[act[k]] = 0;
+    BP.n_active[w] = 0;
+}
+
+static void bp_tick(void)
+{
+    const double alpha = 0.3;
+    MTX_LOCK(&BP.mtx, "BP");
+    if (BP.win_count > 0)
+    {
+        double win_ms = (double)BP.win_lat_ns / BP.win_count / 1e6;
+        BP.ewma_latency_ms = alpha * win_ms + (1.0 - alpha) * BP.ewma_latency_ms;
+    }
+    BP.ewma_depth = alpha * BP.inflight + (1.0 - alpha) * BP.ewma_depth;
+
+    int dir = 0;
+    if (BP.ewma_latency_ms > BP.target_ms)
+    {
+        // sobrecarga: recorte multiplicativo de admisión
+        BP.overload_ticks++;
+        BP.admit_limit = BP.admit_limit * 3 / 4;
+        if (BP.admit_limit < 1)
+            BP.admit_limit = 1;
+        dir = 1;
+    }
+    else if (BP.ewma_latency_ms < 0.8 * BP.target_ms)
+    {
+        // holgura: apertura aditiva
+        BP.admit_limit += BP.admit_step;
+        if (BP.admit_limit > CFG.queue_cap)
+            BP.admit_limit = CFG.queue_cap;
+        dir = -1;
+    }
+    BP.win_count = 0;
+    BP.win_lat_ns = 0;
+    int closed = BP.win;
+    BP.win ^= 1;
+    pthread_cond_broadcast(&BP.slot_free);
+    MTX_UNLOCK(&BP.mtx);
+
+    if (BP.n_tables > 0)
+        bp_adapt_cooldowns(closed, dir);
+}
+
+static void bp_stop(void)
+{
+    MTX_LOCK(&BP.mtx, "BP");
+    BP.stop = 1;
+    pthread_cond_broadcast(&BP.slot_free);
+    MTX_UNLOCK(&BP.mtx);
+}
+
+static void bp_destroy(void)
+{
+    free(BP.cooldown_ms);
+    free(BP.braked);
+    free(BP.is_braked);
+    for (int w = 0; w < 2; w++)
+    {
+        free(BP.win_table[w]);
+        free(BP.active[w]);
+        BP.win_table[w] = NULL;
+        BP.active[w] = NULL;
+    }
+    BP.cooldown_ms = NULL;
+    BP.braked = NULL;
+    BP.is_braked = NULL;
+    BP.n_tables = 0;
+    pthread_mutex_destroy(&BP.mtx);
+    pthread_cond_destroy(&BP.slot_free);
+}
+
+static long long RUN_T0_NS; // inicio de la simulación (para el throughput)
+static long long FIRST_MOVE_NS; // primera acción aplicada (0 => ninguna); solo el validador escribe
+
+/* ===== histograma de latencia de turno =====
+ * Latencia de turno: desde que el planificador abre el turno hasta que el
+ * validador aplica la acción, descontando la espera deliberada del jugador
+ * (cooldown + think). Cubre despertar, decisión, admisión, cola y validación.
+ * Cubetas log-lineales (8 por potencia de 2, error < 12.5%); solo escribe
+ * el validador.
+ */
+#define LAT_SUB_BITS 3
+#define LAT_BUCKETS (64 << LAT_SUB_BITS)
+
+typedef struct
+{
+    uint64_t b[LAT_BUCKETS];
+    uint64_t count;
+    long long sum_ns, max_ns;
+} lat_hist_t;
+
+static lat_hist_t TURN_HIST;
+static lat_hist_t START_HIST; // inicio de turno: apertura -> acción encolada (sin cooldown/think)
+
+// resultado de --speculate al abrirse cada turno (lo escriben los jugadores)
+static struct
+{
+    atomic_long hits;  // acción especulativa usada tal cual
+    atomic_long stale; // el tablero cambió: se decidió de nuevo
+    atomic_long none;  // no había acción especulativa
+} SPEC;
+
+static int lat_bucket(uint64_t v)
+{
+    if (v < (1u << LAT_SUB_BITS))
+        return (int)v;
+    int msb = 63 - __builtin_clzll(v);
+    return ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) + (int)((v >> (msb - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1));
+}
+
+static uint64_t lat_bucket_upper(int idx)
+{
+    if (idx < (1 << LAT_SUB_BITS))
+        return (uint64_t)idx;
+    int shift = (idx >> LAT_SUB_BITS) - 1;
+    uint64_t lower = (uint64_t)((1 << LAT_SUB_BITS) + (idx & ((1 << LAT_SUB_BITS) - 1))) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+static void lat_hist_add(lat_hist_t *h, long long ns)
+{
+    if (ns < 0)
+        ns = 0;
+    h->b[lat_bucket((uint64_t)ns)]++;
+    h->count++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns)
+        h->max_ns = ns;
+}
+
+static double lat_hist_pct_ms(const lat_hist_t *h, double q)
+{
+    if (h->count == 0)
+        return 0.0;
+    uint64_t target = (uint64_t)ceil(q * (double)h->count), acc = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++)
+    {
+        acc += h->b[i];
+        if (acc >= target)
+        {
+            uint64_t up = lat_bucket_upper(i);
+            return (up > (uint64_t)h->max_ns ? (uint64_t)h->max_ns : up) / 1e6;
+        }
+    }
+    return h->max_ns / 1e6;
+}
+
+static void pimc_print_stats(void); // estrategia PIMC, más abajo
+static void oc_print_stats(void);   // caché de resultados, más abajo
+static void dealer_print_stats(void); // reparto anticipado, más abajo
+
+static void print_stats(void)
+{
+    int cap = 0;
+    int depth = q_depth(&GQ, &cap);
+    double secs = (now_ns() - RUN_T0_NS) / 1e9;
+    MTX_LOCK(&BP.mtx, "BP");
+    double avg_ms = BP.total_count ? (double)BP.total_lat_ns / BP.total_count / 1e6 : 0.0;
+    printf("[Stats] t=%.2f s acciones=%ld (%.0f/s) cola=%d/%d latencia media=%.3f ms máx=%.3f ms\n",
+           secs, BP.total_count, secs > 0 ? BP.total_count / secs : 0.0, depth, cap, avg_ms, BP.max_lat_ns / 1e6);
+    printf("[Stats] latencia de turno: p50=%.3f ms p99=%.3f ms máx=%.3f ms (%llu turnos)\n",
+           lat_hist_pct_ms(&TURN_HIST, 0.50), lat_hist_pct_ms(&TURN_HIST, 0.99), TURN_HIST.max_ns / 1e6,
+           (unsigned long long)TURN_HIST.count);
+    printf("[Stats] inicio de turno (apertura -> encolado): p50=%.3f ms p99=%.3f ms media=%.3f ms\n",
+           lat_hist_pct_ms(&START_HIST, 0.50), lat_hist_pct_ms(&START_HIST, 0.99),
+           START_HIST.count ? START_HIST.sum_ns / 1e6 / START_HIST.count : 0.0);
+    MTX_LOCK(&W.mtx, "rueda");
+    printf("[Stats] rueda de temporizadores: armados=%ld disparados=%ld cancelados=%ld pendientes=%ld "
+           "quantum agotados=%ld\n",
+           W.n_armed, W.n_fired, W.n_cancelled, W.armed, atomic_load(&QUANTUM_EXPIRED));
+    MTX_UNLOCK(&W.mtx);
+    if (CFG.speculate)
+    {
+        long h = atomic_load(&SPEC.hits), st = atomic_load(&SPEC.stale), no = atomic_load(&SPEC.none);
+        printf("[Stats] especulación: aciertos=%ld (%.1f%%) obsoletas=%ld sin especular=%ld\n", h,
+               h + st + no ? 100.0 * h / (h + st + no) : 0.0, st, no);
+    }
+    if (BP.enabled)
+    {
+        int braked = 0, max_cd = 0;
+        for (int i = 0; i < BP.n_tables; i++)
+        {
+            int c = bp_cooldown_ms(i);
+            braked += c > 0;
+            if (c > max_cd)
+                max_cd = c;
+        }
+        printf("[Stats] contrapresión: objetivo=%d ms ewma_lat=%.3f ms ewma_cola=%.1f "
+               "admisión=%d en_vuelo=%d cooldown=+%d ms máx (%d mesas) retenidas=%ld/%ld sobrecarga=%ld ticks\n",
+               BP.target_ms, BP.ewma_latency_ms, BP.ewma_depth, BP.admit_limit, BP.inflight, max_cd, braked,
+               BP.throttled, BP.admitted, BP.overload_ticks);
+    }
+    MTX_UNLOCK(&BP.mtx);
+    pimc_print_stats();
+    oc_print_stats();
+    dealer_print_stats();
+}
+
+/* ===== cola de cambios de política / quantum ===== */
+typedef struct
+{
+    int table_id;
+    int change_policy;
+    policy_t new_policy;
+    int change_quantum;
+    int new_quantum_ms;
+    uint32_t epoch; // época global al pedirlo: una publicación global posterior manda
+} policy_change_t;
+
+typedef struct
+{
+    policy_change_t *buf;
+    int head, tail, size, capacity;
+    int stop;
+    pthread_mutex_t mtx;
+    pthread_cond_t not_empty;
+} policy_queue_t;
+
+static policy_queue_t POLICY_Q;
+
+static void policy_q_init(policy_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+    q->capacity = 32;
+    q->buf = malloc(sizeof(policy_change_t) * q->capacity);
+    if (!q->buf)
+    {
+        perror("malloc policy queue");
+        exit(1);
+    }
+    pthread_mutex_init(&q->mtx, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+}
+
+static void policy_q_grow(policy_queue_t *q)
+{
+    int new_cap = q->capacity * 2;
+    policy_change_t *nbuf = malloc(sizeof(policy_change_t) * new_cap);
+    if (!nbuf)
+    {
+        perror("malloc policy queue grow");
+        exit(1);
+    }
+    for (int i = 0; i < q->size; i++)
+        nbuf[i] = q->buf[(q->head + i) % q->capacity];
+    free(q->buf);
+    q->buf = nbuf;
+    q->capacity = new_cap;
+    q->head = 0;
+    q->tail = q->size;
+}
+
+static void policy_q_push(policy_queue_t *q, policy_change_t ch)
+{
+    MTX_LOCK(&q->mtx, "POLICY_Q");
+    if (q->stop)
+    {
+        MTX_UNLOCK(&q->mtx);
+        return;
+    }
+    if (q->size == q->capacity)
+        policy_q_grow(q);
+    q->buf[q->tail] = ch;
+    q->tail = (q->tail + 1) % q->capacity;
+    q->size++;
+    pthread_cond_signal(&q->not_empty);
+    MTX_UNLOCK(&q->mtx);
+}
+
+static int policy_q_try_pop(policy_queue_t *q, policy_change_t *out)
+{
+    int ret = 0;
+    MTX_LOCK(&q->mtx, "POLICY_Q");
+    if (q->size > 0)
+    {
+        *out = q->buf[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->size--;
+        ret = 1;
+    }
+    else if (q->stop)
+    {
+        ret = -1;
+    }
+    MTX_UNLOCK(&q->mtx);
+    return ret;
+}
+
+static void policy_q_stop(policy_queue_t *q)
+{
+    MTX_LOCK(&q->mtx, "POLICY_Q");
+    q->stop = 1;
+    pthread_cond_broadcast(&q->not_empty);
+    MTX_UNLOCK(&q->mtx);
+}
+
+static void policy_q_destroy(policy_queue_t *q)
+{
+    pthread_mutex_destroy(&q->mtx);
+    pthread_cond_destroy(&q->not_empty);
+    free(q->buf);
+}
+
+static uint32_t gcfg_epoch(void); // configuración global, más abajo
+
+static void request_policy_change(int table_id, policy_t newp)
+{
+    policy_change_t ch = {
+        .table_id = table_id,
+        .change_policy = 1,
+        .new_policy = newp,
+        .change_quantum = 0,
+        .new_quantum_ms = 0,
+        .epoch = gcfg_epoch(),
+    };
+    policy_q_push(&POLICY_Q, ch);
+}
+
+static void request_quantum_change(int table_id, int quantum_ms)
+{
+    policy_change_t ch = {
+        .table_id = table_id,
+        .change_policy = 0,
+        .change_quantum = 1,
+        .new_quantum_ms = quantum_ms,
+        .epoch = gcfg_epoch(),
+    };
+    policy_q_push(&POLICY_Q, ch);
+}
+
+static int parse_policy(const char *s, policy_t *out)
+{
+    static const policy_t all[] = {FCFS, SJF_PLAYERS, SJF_POINTS, RR};
+    for (size_t i = 0; i < sizeof(all) / sizeof(all[0]); i++)
+        if (strcasecmp(s, policy_name(all[i])) == 0)
+        {
+            *out = all[i];
+            return 1;
+        }
+    return 0;
+}
+
+static int evaluate_auto_policy(const table_summary_t *g, policy_t *next_out)
+{
+    if (g->nplayers <= 0)
+        return 0;
+
+    int min_tiles = INT_MAX, max_tiles = 0;
+    int min_points = INT_MAX, max_points = 0;
+
+    for (int p = 0; p < g->nplayers; ++p)
+    {
+        int tiles = g->hand_len[p];
+        if (tiles < min_tiles)
+            min_tiles = tiles;
+        if (tiles > max_tiles)
+            max_tiles = tiles;
+
+        int pts = g->points[p];
+        if (pts < min_points)
+            min_points = pts;
+        if (pts > max_points)
+            max_points = pts;
+    }
+
+    int tile_gap = max_tiles - min_tiles;
+    int point_gap = max_points - min_points;
+
+    if (g->pass_streak >= g->nplayers && g->policy != RR)
+    {
+        *next_out = RR;
+        return 1;
+    }
+
+    if (tile_gap >= 3 && g->policy != SJF_PLAYERS)
+    {
+        *next_out = SJF_PLAYERS;
+        return 1;
+    }
+
+    if (point_gap >= 12 && g->policy != SJF_POINTS)
+    {
+        *next_out = SJF_POINTS;
+        return 1;
+    }
+
+    if (g->policy == SJF_POINTS && tile_gap >= 3)
+    {
+        *next_out = SJF_PLAYERS;
+        return 1;
+    }
+
+    if (g->policy == SJF_PLAYERS && point_gap >= 12)
+    {
+        *next_out = SJF_POINTS;
+        return 1;
+    }
+
+    if (g->policy != FCFS && tile_gap <= 1 && point_gap <= 6 && g->pass_streak == 0)
+    {
+        *next_out = FCFS;
+        return 1;
+    }
+
+    if (g->policy == RR && g->pass_streak == 0 && tile_gap >= 3)
+    {
+        *next_out = SJF_PLAYERS;
+        return 1;
+    }
+
+    return 0;
+}
+
+static int supervisor_apply_policy_change(game_state_t *g, policy_t new_policy, const char *reason)
+{
+    if (g->policy == new_policy)
+        return 0;
+
+    policy_t old = g->policy;
+    g->policy = new_policy;
+    g->perturbed = 1;
+    if (g->switches < UINT8_MAX)
+        g->switches++;
+    TLOG(">> Supervisor%s: Mesa %d cambia política %s -> %s\n",
+           reason ? reason : "", g->table_id, policy_name(old), policy_name(new_policy));
+    fflush(stdout);
+    snapshot_publish(g);
+    pthread_cond_broadcast(&g->cv);
+    return 1;
+}
+
+/* ===== configuración global versionada =====
+ * policy all / quantum all no encolan un cambio por mesa: publican un bloque
+ * inmutable con la época siguiente, un solo puntero atómico. Cada bloque
+ * acumula los anteriores y recuerda en qué época se fijó cada campo. El
+ * planificador compara épocas al abrir cada turno (ya con g->mtx tomado) y
+ * aplica solo los campos fijados después de la última que vio esa mesa, así
+ * que el cambio llega en un turno. Las mesas que arrancan más tarde lo
+ * recogen en su primer turno. Los cambios de una sola mesa siguen por
+ * POLICY_Q; ganan salvo que se haya publicado un cambio global del mismo
+ * campo después de pedirlos. Los bloques viejos se liberan al acabar la
+ * simulación, cuando ya nadie los lee.
+ */
+typedef struct global_cfg_s
+{
+    uint32_t epoch;
+    uint32_t policy_epoch, quantum_epoch; // 0 => campo nunca fijado
+    policy_t policy;
+    int quantum_ms;
+    struct global_cfg_s *prev; // cadena para liberar al final
+} global_cfg_t;
+
+static struct
+{
+    _Atomic(global_cfg_t *) cur; // NULL => época 0, nada publicado
+    pthread_mutex_t mtx;         // serializa publicadores
+} GCFG = {.mtx = PTHREAD_MUTEX_INITIALIZER};
+
+static uint32_t gcfg_epoch(void)
+{
+    global_cfg_t *c = atomic_load_explicit(&GCFG.cur, memory_order_acquire);
+    return c ? c->epoch : 0;
+}
+
+// nuevo bloque = el vigente + el campo indicado; devuelve la época publicada
+static uint32_t gcfg_publish(int set_policy, policy_t policy, int set_quantum, int quantum_ms)
+{
+    global_cfg_t *n = malloc(sizeof(*n));
+    if (!n)
+    {
+        perror("malloc global cfg");
+        return gcfg_epoch();
+    }
+    MTX_LOCK(&GCFG.mtx, "GCFG");
+    global_cfg_t *old = atomic_load_explicit(&GCFG.cur, memory_order_relaxed);
+    if (old)
+        *n = *old;
+    else
+        memset(n, 0, sizeof(*n));
+    n->epoch = old ? old->epoch + 1 : 1;
+    n->prev = old;
+    if (set_policy)
+    {
+        n->policy = policy;
+        n->policy_epoch = n->epoch;
+    }
+    if (set_quantum)
+    {
+        n->quantum_ms = quantum_ms;
+        n->quantum_epoch = n->epoch;
+    }
+    atomic_store_explicit(&GCFG.cur, n, memory_order_release);
+    MTX_UNLOCK(&GCFG.mtx);
+    return n->epoch;
+}
+
+// con g->mtx tomado: aplica lo publicado desde la última época que vio la mesa
+static void gcfg_pickup(game_state_t *g)
+{
+    global_cfg_t *c = atomic_load_explicit(&GCFG.cur, memory_order_acquire);
+    if (!c || c->epoch == g->cfg_epoch)
+        return;
+    if (c->policy_epoch > g->cfg_epoch)
+        supervisor_apply_policy_change(g, c->policy, " (global)");
+    if (c->quantum_epoch > g->cfg_epoch && g->rr_quantum_ms != c->quantum_ms)
+    {
+        g->rr_quantum_ms = c->quantum_ms;
+        TLOG(">> Supervisor (global): Mesa %d ajusta quantum = %d ms\n", g->table_id, g->rr_quantum_ms);
+        snapshot_publish(g);
+    }
+    g->cfg_epoch = c->epoch;
+}
+
+// al acabar la simulación: ya no queda ningún lector
+static void gcfg_reset(void)
+{
+    global_cfg_t *c = atomic_exchange(&GCFG.cur, NULL);
+    while (c)
+    {
+        global_cfg_t *prev = c->prev;
+        free(c);
+        c = prev;
+    }
+}
+
+/* ===== búsqueda de jugada posible ===== */
+// ficha de menor índice que encaja, primero en el extremo izquierdo
+static int find_play(game_state_t *g, int pid, tile_t *tile_out, int *side_out)
+{
+    return ENGINE.find_play(g->hands[pid], g->left_end, g->right_end, tile_out, side_out);
+}
+
+/* ===== estrategia PIMC (--strategy=pimc) =====
+ * Perfect Information Monte Carlo: el jugador muestrea repartos de las
+ * fichas que no ha visto (manos rivales + pozo) compatibles con lo que sabe
+ * (tamaño de cada mano, tamaño del pozo y números que un rival no tiene
+ * porque pasó con ellos en los extremos) y, en cada reparto, juega cada
+ * jugada legal hasta el final con una partida rápida sobre máscaras de
+ * bits. Elige la jugada con más victorias.
+ *
+ * Las partidas simuladas las ejecuta un pool de hilos compartido por todas
+ * las mesas, en tramos cortos y repartidos hacia el trabajo con menos
+ * mundos. El jugador publica su trabajo y duerme hasta el plazo del turno
+ * (--pimc-budget-us): la latencia de decisión está acotada y la calidad
+ * crece con los núcleos del pool (--pimc-threads=0 calcula en el propio
+ * hilo del jugador). Las partidas simuladas usan
+ * turno circular (el planificador real puede elegir otro orden).
+ */
+#define PIMC_MAX_MOVES (2 * MAX_TILES)
+#define PIMC_MAX_ROLLOUT_STEPS 400
+#define PIMC_SLICE_WORLDS 16 // mundos por tramo antes de volver a elegir trabajo
+
+// lo que sabe el jugador 'me' al decidir (copiado con g->mtx tomado)
+typedef struct
+{
+    int nplayers, me;
+    tmask_t mine;    // mano propia
+    tmask_t unknown; // fichas no vistas: manos rivales + pozo
+    int hand_len[MAX_PLAYERS];
+    int pool_len, left, right;
+    uint16_t voids[MAX_PLAYERS]; // bit n: el jugador no tiene el número n
+    int nmoves;
+    int move_tile[PIMC_MAX_MOVES], move_side[PIMC_MAX_MOVES];
+} pimc_view_t;
+
+typedef struct pimc_job_s
+{
+    struct pimc_job_s *next;
+    const pimc_view_t *v;
+    atomic_llong deadline_ns; // se adelanta al cancelar
+    long long t0_ns;
+    int helpers, closed; // PIMC.mtx
+    atomic_long wins[PIMC_MAX_MOVES];
+    atomic_long worlds;
+} pimc_job_t;
+
+static struct
+{
+    pthread_mutex_t mtx;
+    pthread_cond_t work; // hay trabajos nuevos
+    pthread_cond_t idle; // un ayudante dejó un trabajo
+    pimc_job_t *jobs;
+    int stop, n_threads;
+    pthread_t *th;
+    // bucle de mundos de un trabajo: núcleo según el juego de fichas
+    long (*simulate)(pimc_job_t *job, rng_t *r, long max_worlds, long wins[]);
+
+    // estadísticas de la ejecución
+    atomic_long decisions, worlds, think_ns, max_think_ns;
+    atomic_long wins_by_seat[MAX_PLAYERS];
+} PIMC = {.mtx = PTHREAD_MUTEX_INITIALIZER, .work = PTHREAD_COND_INITIALIZER, .idle = PTHREAD_COND_INITIALIZER};
+
+static int pimc_seat(int pid) { return CFG.strategy == STRAT_PIMC && (CFG.pimc_seats >> pid & 1); }
+
+/* ----- núcleos PIMC por ancho de máscara -----
+ * PIMC_KERNELS(W, ...) instancia para máscaras de W bits:
+ *   rand_bit_W      un bit al azar de la máscara
+ *   pimc_deal_W     reparte v->unknown entre rivales y pozo (0 si no encontró
+ *                   reparto compatible con los números que faltan)
+ *   pimc_playout_W  partida aleatoria desde 'turn'; devuelve el ganador
+ *   pimc_worlds_W   bucle de mundos de un trabajo: mismo mundo para todas las
+ *                   jugadas (comparación emparejada), sin pasar el plazo
+ * Solo cambian el tipo y los intrínsecos: el doble-6 no paga las máscaras
+ * anchas del doble-12. mask_points_W viene de ENGINE_KERNELS.
+ */
+#define PIMC_KERNELS(W, mask_t, NUMS, POPCNT, CTZ)                                                      \
+    static inline int rand_bit_##W(mask_t m, rng_t *r)                                                  \
+    {                                                                                                   \
+        int k = (int)(rng_next(r) % (uint64_t)POPCNT(m));                                               \
+        while (k--)                                                                                     \
+            m &= m - 1;                                                                                 \
+        return CTZ(m);                                                                                  \
+    }                                                                                                   \
+                                                                                                        \
+    static int pimc_deal_##W(const pimc_view_t *v, rng_t *r, int use_voids, mask_t hands[], mask_t *pool) \
+    {                                                                                                   \
+        int tiles[MAX_TILES], n = 0;                                                                    \
+        for (mask_t m = (mask_t)v->unknown; m; m &= m - 1)                                              \
+            tiles[n++] = CTZ(m);                                                                        \
+        for (int i = n - 1; i > 0; i--)                                                                 \
+        {                                                                                               \
+            int j = (int)(rng_next(r) % (uint64_t)(i + 1));                                             \
+            int tmp = tiles[i];                                                                         \
+            tiles[i] = tiles[j];                                                                        \
+            tiles[j] = tmp;                                                                             \
+        }                                                                                               \
+        int need[MAX_PLAYERS + 1]; /* último hueco: el pozo */                                         \
+        for (int p = 0; p < v->nplayers; p++)                                                           \
+        {                                                                                               \
+            need[p] = p == v->me ? 0 : v->hand_len[p];                                                  \
+            hands[p] = p == v->me ? (mask_t)v->mine : 0;                                                \
+        }                                                                                               \
+        need[MAX_PLAYERS] = v->pool_len;                                                                \
+        *pool = 0;                                                                                      \
+                                                                                                        \
+        for (int k = 0; k < n; k++)                                                                     \
+        {                                                                                               \
+            int t = tiles[k];                                                                           \
+            uint16_t nums = (uint16_t)(1u << TILE_LO[t] | 1u << TILE_HI[t]);                            \
+            int total = need[MAX_PLAYERS];                                                              \
+            for (int p = 0; p < v->nplayers; p++)                                                       \
+                if (need[p] && !(use_voids && (v->voids[p] & nums)))                                    \
+                    total += need[p];                                                                   \
+            if (total == 0)                                                                             \
+                return 0;                                                                               \
+            int pick = (int)(rng_next(r) % (uint64_t)total);                                            \
+            int slot = MAX_PLAYERS;                                                                     \
+            for (int p = 0; p < v->nplayers; p++)                                                       \
+            {                                                                                           \
+                if (!need[p] || (use_voids && (v->voids[p] & nums)))                                    \
+                    continue;                                                                           \
+                if (pick < need[p])                                                                     \
+                {                                                                                       \
+                    slot = p;                                                                           \
+                    break;                                                                              \
+                }                                                                                       \
+                pick -= need[p];                                                                        \
+            }                                                                                           \
+            need[slot]--;                                                                               \
+            if (slot == MAX_PLAYERS)                                                                    \
+                *pool |= (mask_t)1 << t;                                                                \
+            else                                                                                        \
+                hands[slot] |= (mask_t)1 << t;                                                          \
+        }                                                                                               \
+        return 1;                                                                                       \
+    }                                                                                                   \
+                                                                                                        \
+    static int pimc_playout_##W(mask_t hands[], mask_t pool, int np, int left, int right, int turn, rng_t *r) \
+    {                                                                                                   \
+        int pool_len = POPCNT(pool), pass_streak = 0;                                                   \
+        for (int step = 0; step < PIMC_MAX_ROLLOUT_STEPS; step++)                                       \
+        {                                                                                               \
+            mask_t legal = hands[turn] & (NUMS[left] | NUMS[right]);                                    \
+            if (legal)                                                                                  \
+            {                                                                                           \
+                int t = rand_bit_##W(legal, r);                                                         \
+                hands[turn] &= ~((mask_t)1 << t);                                                       \
+                int lo = TILE_LO[t], hi = TILE_HI[t];                                                   \
+                int on_left = (lo == left || hi == left) && (!(lo == right || hi == right) || (rng_next(r) & 1)); \
+                if (on_left)                                                                            \
+                    left = lo == left ? hi : lo;                                                        \
+                else                                                                                    \
+                    right = lo == right ? hi : lo;                                                      \
+                pass_streak = 0;                                                                        \
+                if (!hands[turn])                                                                       \
+                    return turn;                                                                        \
+            }                                                                                           \
+            else if (pool_len > 0)                                                                      \
+            {                                                                                           \
+                int t = rand_bit_##W(pool, r);                                                          \
+                pool &= ~((mask_t)1 << t);                                                              \
+                pool_len--;                                                                             \
+                hands[turn] |= (mask_t)1 << t;                                                          \
+            }                                                                                           \
+            else if (++pass_streak >= np)                                                               \
+                break;                                                                                  \
+            turn = (turn + 1) % np;                                                                     \
+        }                                                                                               \
+        /* cierre: menor puntaje, luego menos fichas (como winner_lowest_points) */                    \
+        int win = 0;                                                                                    \
+        for (int p = 1; p < np; p++)                                                                    \
+        {                                                                                               \
+            int dp = mask_points_##W(hands[p]) - mask_points_##W(hands[win]);                           \
+            if (dp < 0 || (dp == 0 && POPCNT(hands[p]) < POPCNT(hands[win])))                           \
+                win = p;                                                                                \
+        }                                                                                               \
+        return win;                                                                                     \
+    }                                                                                                   \
+                                                                                                        \
+    static long pimc_worlds_##W(pimc_job_t *job, rng_t *r, long max_worlds, long wins[])                \
+    {                                                                                                   \
+        const pimc_view_t *v = job->v;                                                                  \
+        mask_t hands[MAX_PLAYERS], pool, h[MAX_PLAYERS];                                                \
+        long worlds = 0;                                                                                \
+        while (worlds < max_worlds && now_ns() < atomic_load_explicit(&job->deadline_ns, memory_order_relaxed)) \
+        {                                                                                               \
+            int dealt = 0;                                                                              \
+            for (int tries = 0; tries < 8 && !dealt; tries++)                                           \
+                dealt = pimc_deal_##W(v, r, 1, hands, &pool);                                           \
+            if (!dealt && !pimc_deal_##W(v, r, 0, hands, &pool))                                        \
+                break;                                                                                  \
+            for (int m = 0; m < v->nmoves; m++)                                                         \
+            {                                                                                           \
+                memcpy(h, hands, sizeof(h));                                                            \
+                int t = v->move_tile[m], lo = TILE_LO[t], hi = TILE_HI[t];                              \
+                int left = v->left, right = v->right;                                                   \
+                h[v->me] &= ~((mask_t)1 << t);                                                          \
+                if (!h[v->me])                                                                          \
+                {                                                                                       \
+                    wins[m]++; /* domina */                                                             \
+                    continue;                                                                           \
+                }                                                                                       \
+                if (v->move_side[m] < 0)                                                                \
+                    left = lo == left ? hi : lo;                                                        \
+                else                                                                                    \
+                    right = lo == right ? hi : lo;                                                      \
+                if (pimc_playout_##W(h, pool, v->nplayers, left, right, (v->me + 1) % v->nplayers, r) == v->me) \
+                    wins[m]++;                                                                          \
+            }                                                                                           \
+            worlds++;                                                                                   \
+        }                                                                                               \
+        return worlds;                                                                                  \
+    }
+
+PIMC_KERNELS(32, uint32_t, NUM_MASK32, __builtin_popcount, __builtin_ctz)
+#if MAX_PIP > 6
+PIMC_KERNELS(64, uint64_t, NUM_MASK64, __builtin_popcountll, __builtin_ctzll)
+#endif
+#if MAX_PIP > 9
+PIMC_KERNELS(128, unsigned __int128, NUM_MASK, popcount128, ctz128)
+#endif
+
+// núcleo más estrecho en el que caben las fichas del juego
+static void pimc_select_kernels(int pips)
+{
+    (void)pips; // sin uso si solo se compiló el doble-6
+    PIMC.simulate = pimc_worlds_32;
+#if MAX_PIP > 6
+    if (SET_TILES(pips) > 32)
+        PIMC.simulate = pimc_worlds_64;
+#endif
+#if MAX_PIP > 9
+    if (SET_TILES(pips) > 64)
+        PIMC.simulate = pimc_worlds_128;
+#endif
+}
+
+// simula hasta max_worlds mundos sin pasar el plazo del trabajo
+static void pimc_work(pimc_job_t *job, rng_t *r, long max_worlds)
+{
+    const pimc_view_t *v = job->v;
+    long wins[PIMC_MAX_MOVES];
+    memset(wins, 0, sizeof(wins[0]) * v->nmoves);
+    long worlds = PIMC.simulate(job, r, max_worlds, wins);
+    for (int m = 0; m < v->nmoves; m++)
+        if (wins[m])
+            atomic_fetch_add_explicit(&job->wins[m], wins[m], memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->worlds, worlds, memory_order_relaxed);
+}
+
+void *pimc_helper_thread(void *arg)
+{
+    rng_t rng = {.s = (uint64_t)CFG.seed * 0x9e3779b97f4a7c15ULL + (uintptr_t)arg};
+    TRACE_THREAD("pimc");
+    MTX_LOCK(&PIMC.mtx, "PIMC");
+    for (;;)
+    {
+        // reparto equitativo: el trabajo abierto con menos mundos simulados
+        pimc_job_t *best = NULL;
+        long long now = now_ns();
+        for (pimc_job_t *j = PIMC.jobs; j; j = j->next)
+            if (!j->closed && atomic_load_explicit(&j->deadline_ns, memory_order_relaxed) > now &&
+                (!best || atomic_load_explicit(&j->worlds, memory_order_relaxed) <
+                              atomic_load_explicit(&best->worlds, memory_order_relaxed)))
+                best = j;
+        if (!best)
+        {
+            if (PIMC.stop)
+                break;
+            CV_WAIT(&PIMC.work, &PIMC.mtx);
+            continue;
+        }
+        best->helpers++;
+        MTX_UNLOCK(&PIMC.mtx);
+        TRACE_BEGIN(ro);
+        pimc_work(best, &rng, PIMC_SLICE_WORLDS);
+        TRACE_END(ro, "rollouts");
+        MTX_LOCK(&PIMC.mtx, "PIMC");
+        if (--best->helpers == 0)
+            pthread_cond_broadcast(&PIMC.idle);
+    }
+    MTX_UNLOCK(&PIMC.mtx);
+    return NULL;
+}
+
+// copia lo que 'pid' puede ver y sus jugadas legales; requiere g->mtx
+static void pimc_view(game_state_t *g, int pid, pimc_view_t *v)
+{
+    memset(v, 0, sizeof(*v));
+    v->nplayers = g->nplayers;
+    v->me = pid;
+    v->pool_len = g->pool_len;
+    v->left = g->left_end;
+    v->right = g->right_end;
+    v->mine = g->hands[pid];
+    v->unknown = (TILE_BIT(SET_TILES(CFG.pips)) - 1) & ~g->played & ~v->mine;
+    for (int p = 0; p < g->nplayers; p++)
+    {
+        v->hand_len[p] = g->hand_len[p];
+        v->voids[p] = g->voids[p];
+    }
+    for (tmask_t m = v->mine; m; m &= m - 1)
+    {
+        int t = tmask_ctz(m);
+        int fits_l = TILE_LO[t] == v->left || TILE_HI[t] == v->left;
+        int fits_r = TILE_LO[t] == v->right || TILE_HI[t] == v->right;
+        if (fits_l)
+        {
+            v->move_tile[v->nmoves] = t;
+            v->move_side[v->nmoves++] = -1;
+        }
+        if (fits_r && !(fits_l && v->left == v->right))
+        {
+            v->move_tile[v->nmoves] = t;
+            v->move_side[v->nmoves++] = +1;
+        }
+    }
+}
+
+// publica la búsqueda de v (v->nmoves > 1) con el plazo configurado y
+// vuelve sin esperar; sin pool, calcula aquí mismo hasta el plazo
+static void pimc_submit(pimc_job_t *job, const pimc_view_t *v, rng_t *r)
+{
+    memset(job, 0, sizeof(*job));
+    job->v = v;
+    job->t0_ns = now_ns();
+    atomic_init(&job->deadline_ns, job->t0_ns + (long long)CFG.pimc_budget_us * 1000);
+    for (int m = 0; m < v->nmoves; m++)
+        atomic_init(&job->wins[m], 0);
+    atomic_init(&job->worlds, 0);
+    if (PIMC.n_threads == 0)
+    {
+        pimc_work(job, r, LONG_MAX);
+        return;
+    }
+    MTX_LOCK(&PIMC.mtx, "PIMC");
+    job->next = PIMC.jobs;
+    PIMC.jobs = job;
+    pthread_cond_broadcast(&PIMC.work);
+    MTX_UNLOCK(&PIMC.mtx);
+}
+
+// cierra la búsqueda: con cancel=0 espera al plazo y devuelve la mejor
+// jugada; con cancel=1 la corta ya (resultado sin usar, -1)
+static int pimc_collect(pimc_job_t *job, int cancel)
+{
+    if (PIMC.n_threads > 0)
+    {
+        if (cancel)
+            atomic_store(&job->deadline_ns, 0);
+        else // solo el pool consume CPU: el coste total lo acota su tamaño
+            sleep_ns(atomic_load(&job->deadline_ns) - now_ns());
+        MTX_LOCK(&PIMC.mtx, "PIMC");
+        job->closed = 1;
+        pimc_job_t **pp = &PIMC.jobs;
+        while (*pp != job)
+            pp = &(*pp)->next;
+        *pp = job->next;
+        while (job->helpers > 0)
+            CV_WAIT(&PIMC.idle, &PIMC.mtx);
+        MTX_UNLOCK(&PIMC.mtx);
+    }
+    if (cancel)
+        return -1;
+
+    int best = 0;
+    for (int m = 1; m < job->v->nmoves; m++)
+        if (atomic_load(&job->wins[m]) > atomic_load(&job->wins[best]))
+            best = m;
+
+    long long dt = now_ns() - job->t0_ns;
+    atomic_fetch_add(&PIMC.decisions, 1);
+    atomic_fetch_add(&PIMC.worlds, atomic_load(&job->worlds));
+    atomic_fetch_add(&PIMC.think_ns, dt);
+    long prev = atomic_load(&PIMC.max_think_ns);
+    while (dt > prev && !atomic_compare_exchange_weak(&PIMC.max_think_ns, &prev, dt))
+        ;
+    return best;
+}
+
+static void pimc_start(void)
+{
+    atomic_store(&PIMC.decisions, 0);
+    atomic_store(&PIMC.worlds, 0);
+    atomic_store(&PIMC.think_ns, 0);
+    atomic_store(&PIMC.max_think_ns, 0);
+    for (int p = 0; p < MAX_PLAYERS; p++)
+        atomic_store(&PIMC.wins_by_seat[p], 0);
+    if (CFG.strategy != STRAT_PIMC)
+        return;
+    pimc_select_kernels(CFG.pips);
+    int n = CFG.pimc_threads;
+    if (n < 0) // por defecto: un hilo por CPU menos el del validador, al menos uno
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = cpus > 2 ? (int)cpus - 1 : 1;
+    }
+    PIMC.stop = 0;
+    PIMC.n_threads = 0;
+    PIMC.th = n > 0 ? calloc(n, sizeof(pthread_t)) : NULL;
+    for (int i = 0; i < n && PIMC.th; i++)
+    {
+        if (pthread_create(&PIMC.th[i], NULL, pimc_helper_thread, (void *)(uintptr_t)i) != 0)
+        {
+            perror("pthread_create(pimc)");
+            break;
+        }
+        PIMC.n_threads++;
+    }
+}
+
+static void pimc_stop(void)
+{
+    if (!PIMC.th)
+        return;
+    MTX_LOCK(&PIMC.mtx, "PIMC");
+    PIMC.stop = 1;
+    pthread_cond_broadcast(&PIMC.work);
+    MTX_UNLOCK(&PIMC.mtx);
+    for (int i = 0; i < PIMC.n_threads; i++)
+        pthread_join(PIMC.th[i], NULL);
+    free(PIMC.th);
+    PIMC.th = NULL; // n_threads se conserva para el resumen final
+}
+
+static void pimc_print_stats(void)
+{
+    if (CFG.strategy != STRAT_PIMC)
+        return;
+    long dec = atomic_load(&PIMC.decisions);
+    printf("[PIMC] decisiones=%ld mundos/decisión=%.0f pensar medio=%.0f us máx=%.0f us (plazo %d us, %d hilos)\n",
+           dec, dec ? (double)atomic_load(&PIMC.worlds) / dec : 0.0,
+           dec ? atomic_load(&PIMC.think_ns) / 1e3 / dec : 0.0, atomic_load(&PIMC.max_think_ns) / 1e3,
+           CFG.pimc_budget_us, PIMC.n_threads);
+    printf("[PIMC] victorias por asiento:");
+    for (int p = 0; p < CFG.max_players; p++)
+        printf(" J%d=%ld%s", p, atomic_load(&PIMC.wins_by_seat[p]), pimc_seat(p) ? "*" : "");
+    printf(" (* = PIMC)\n");
+}
+
+/* ===== jugadores (productores) ===== */
+static long long think_time_ns(rng_t *rng)
+{
+    double ms = 0.0;
+    switch (CFG.think)
+    {
+    case THINK_NONE:
+        return 0;
+    case THINK_CONST:
+        ms = CFG.think_ms;
+        break;
+    case THINK_EXP:
+        ms = rng_exp(rng, CFG.think_ms);
+        break;
+    case THINK_UNIFORM:
+        ms = rng_unit(rng) * 2.0 * CFG.think_ms;
+        break;
+    }
+    return (long long)(ms * 1e6);
+}
+
+typedef struct
+{
+    game_state_t *g;
+    int pid;
+} player_args_t;
+
+/* ----- decisión de la acción -----
+ * Con --speculate el jugador que va a tener el turno siguiente (según la
+ * política de la mesa) decide en cuanto el validador aplica la acción
+ * anterior, mientras espera. Al abrirse su turno usa esa acción si el
+ * tablero con el que la calculó sigue igual (extremos, su mano y si queda
+ * pozo); si no, decide de nuevo.
+ */
+typedef struct
+{
+    int left, right, hand_len, pool_nonempty;
+} board_key_t;
+
+static board_key_t board_key(game_state_t *g, int pid)
+{
+    board_key_t k = {g->left_end, g->right_end, g->hand_len[pid], g->pool_len > 0};
+    return k;
+}
+
+static int board_key_eq(board_key_t a, board_key_t b)
+{
+    return a.left == b.left && a.right == b.right && a.hand_len == b.hand_len && a.pool_nonempty == b.pool_nonempty;
+}
+
+// acción de la estrategia simple (primera ficha jugable); requiere g->mtx
+static action_t plan_first(game_state_t *g, int pid)
+{
+    action_t a = {.table_id = g->table_id, .player_id = pid};
+    tile_t t = 0;
+    int side = 0;
+    if (find_play(g, pid, &t, &side))
+    {
+        a.kind = ACT_PLAY;
+        a.tile = t;
+        a.side = side;
+    }
+    else if (g->pool_len > 0)
+    {
+        a.kind = ACT_DRAW;
+    }
+    else
+    {
+        a.kind = ACT_PASS;
+    }
+    return a;
+}
+
+// ¿hay que buscar con PIMC? rellena *v; requiere g->mtx
+static int needs_pimc(game_state_t *g, int pid, int use_pimc, pimc_view_t *v)
+{
+    if (!use_pimc || g->train_len == 0)
+        return 0;
+    pimc_view(g, pid, v);
+    return v->nmoves > 1;
+}
+
+// jugada m de v sobre la mano actual (la mano no cambia fuera de nuestro turno)
+static action_t pimc_action(game_state_t *g, int pid, const pimc_view_t *v, int m)
+{
+    action_t a = {.table_id = g->table_id, .player_id = pid, .kind = ACT_PLAY,
+                  .tile = (tile_t)v->move_tile[m], .side = v->move_side[m]};
+    return a;
+}
+
+static int pick_next_player(game_state_t *g, int current); // planificador, más abajo
+
+// ¿toca especular? entre turnos si la política nos elige a continuación, o
+// durante el cooldown de nuestro propio turno
+static int should_speculate(game_state_t *g, int pid, int spec_steps)
+{
+    if (!CFG.speculate || g->finished || g->turn_seq == 0 || g->train_len == 0 || g->steps == spec_steps)
+        return 0;
+    if (!g->action_done) // nuestro turno abierto pero aún en cooldown: el tablero no cambia
+        return g->turn == pid && !g->turn_ready;
+    return pick_next_player(g, g->turn) == pid;
+}
+
+void *player_thread(void *arg)
+{
+    player_args_t *pa = (player_args_t *)arg;
+    game_state_t *g = pa->g;
+    int pid = pa->pid;
+    free(pa);
+    int last_seq = -1; // último turno en el que ya encolamos acción
+    int use_pimc = pimc_seat(pid);
+    // sembrado por reparto: la misma mesa repite think times y partidas simuladas
+    rng_t rng = {.s = ((uint64_t)g->seed << 32) ^ (uint64_t)pid};
+    TRACE_THREAD("jugador");
+
+    // especulación: spec_act (o la búsqueda spec_job en curso si spec_live)
+    // vale mientras el tablero coincida con spec_key
+    int spec_valid = 0, spec_live = 0, spec_steps = -1;
+    board_key_t spec_key = {0};
+    action_t spec_act = {0};
+    pimc_view_t spec_view;
+    pimc_job_t spec_job;
+
+    for (;;)
+    {
+        MTX_LOCK(&g->mtx, "mesa");
+        // una sola acción por turno planificado: esperar a un turno nuevo
+        while (!g->finished && (g->turn != pid || g->action_done || g->turn_seq == last_seq || !g->turn_ready))
+        {
+            if (should_speculate(g, pid, spec_steps))
+            {
+                // la búsqueda PIMC corre en el pool mientras seguimos esperando
+                if (spec_live)
+                    pimc_collect(&spec_job, 1);
+                spec_steps = g->steps;
+                spec_key = board_key(g, pid);
+                spec_live = needs_pimc(g, pid, use_pimc, &spec_view);
+                spec_valid = !spec_live || PIMC.n_threads > 0; // sin pool no se calcula con g->mtx tomado
+                spec_live = spec_live && spec_valid;
+                if (spec_live)
+                    pimc_submit(&spec_job, &spec_view, &rng);
+                else if (spec_valid)
+                    spec_act = plan_first(g, pid);
+                continue;
+            }
+            CV_WAIT(&g->cv, &g->mtx);
+        }
+        if (g->finished)
+        {
+            MTX_UNLOCK(&g->mtx);
+            break;
+        }
+
+        // tiempo de "pensar" (el cooldown ya lo esperó la rueda)
+        long long delay_ns = think_time_ns(&rng);
+        MTX_UNLOCK(&g->mtx);
+        long long slept_from = now_ns();
+        sleep_ns(delay_ns);
+        long long slept_ns = now_ns() - slept_from;
+        if (delay_ns > 0)
+            TRACE_SPAN("pensar", slept_from, slept_from + slept_ns);
+        MTX_LOCK(&g->mtx, "mesa");
+
+        if (g->finished)
+        {
+            MTX_UNLOCK(&g->mtx);
+            break;
+        }
+        if (g->turn != pid || g->action_done || g->turn_seq == last_seq || g->turn_submitted)
+        {
+            MTX_UNLOCK(&g->mtx);
+            continue;
+        }
+        last_seq = g->turn_seq;
+        g->turn_delay_ns += slept_ns;
+
+        // decidir 1 acción (o reutilizar la especulativa)
+        TRACE_BEGIN(dec);
+        pimc_view_t v;
+        pimc_job_t job, *wait_job = NULL;
+        const pimc_view_t *wait_view = NULL;
+        int submit = 0;
+        action_t planned;
+        if (spec_valid && board_key_eq(spec_key, board_key(g, pid)))
+        {
+            atomic_fetch_add_explicit(&SPEC.hits, 1, memory_order_relaxed);
+            planned = spec_act;
+            if (spec_live)
+            {
+                wait_job = &spec_job;
+                wait_view = &spec_view;
+            }
+        }
+        else
+        {
+            if (CFG.speculate)
+                atomic_fetch_add_explicit(spec_valid ? &SPEC.stale : &SPEC.none, 1, memory_order_relaxed);
+            if (spec_live)
+                pimc_collect(&spec_job, 1);
+            if (needs_pimc(g, pid, use_pimc, &v))
+            {
+                submit = 1;
+                wait_job = &job;
+                wait_view = &v;
+            }
+            else
+                planned = plan_first(g, pid);
+        }
+        spec_valid = spec_live = 0;
+        if (wait_job)
+        {
+            // la búsqueda corre sin g->mtx: nadie más actúa en este turno
+            MTX_UNLOCK(&g->mtx);
+            TRACE_BEGIN(pm);
+            if (submit)
+                pimc_submit(wait_job, wait_view, &rng);
+            int m = pimc_collect(wait_job, 0);
+            TRACE_END(pm, "pimc");
+            MTX_LOCK(&g->mtx, "mesa");
+            if (g->finished || g->action_done || g->turn_seq != last_seq || g->turn_submitted)
+            {
+                MTX_UNLOCK(&g->mtx);
+                continue;
+            }
+            planned = pimc_action(g, pid, wait_view, m);
+        }
+        TRACE_END(dec, "decidir");
+
+        // contrapresión: el hueco en la cola global se pide ya decidida la
+        // acción, justo antes de encolar (sin g->mtx: la espera puede ser larga
+        // y la rueda necesita la mesa para forzar el quantum)
+        MTX_UNLOCK(&g->mtx);
+        TRACE_BEGIN(adm);
+        bp_admit();
+        TRACE_END(adm, "admision");
+        MTX_LOCK(&g->mtx, "mesa");
+        if (g->finished || g->action_done || g->turn_seq != last_seq || g->turn_submitted)
+        {
+            MTX_UNLOCK(&g->mtx);
+            bp_cancel();
+            continue;
+        }
+        TRACE_BEGIN(push);
+        g->turn_submitted = 1;
+        q_push(&GQ, planned);
+        TRACE_END(push, "encolar");
+
+        // esperar a que el validador aplique (cerrando el "turno planificado")
+        TRACE_BEGIN(wv);
+        while (!g->finished && !g->action_done && g->turn_seq == last_seq)
+            CV_WAIT(&g->cv, &g->mtx);
+        MTX_UNLOCK(&g->mtx);
+        TRACE_END(wv, "esperar_validador");
+    }
+    if (spec_live)
+        pimc_collect(&spec_job, 1); // no dejar el trabajo en la lista del pool
+    return NULL;
+}
+
+/* ===== flujo de eventos en memoria compartida =====
+ * Anillo de un productor (el validador) y múltiples lectores en un objeto
+ * POSIX shm. Formato fijo, little-endian, versión 1:
+ *
+ *   offset 0   evt_header_t (64 B)
+ *   offset 64  evt_record_t[capacity] (32 B cada uno, capacity potencia de 2)
+ *
+ * El registro i (0, 1, 2, ...) vive en la ranura i & (capacity - 1). El
+ * productor marca la ranura con seq = 0, escribe el cuerpo, publica
+ * seq = i + 1 y por último avanza head = i + 1. Un lector en la posición p
+ * copia la ranura y la valida releyendo seq == p + 1; si head - p supera la
+ * capacidad, el productor ya lo adelantó: salta al registro más antiguo
+ * disponible y cuenta los perdidos. El productor nunca espera a nadie.
+ */
+#define EVT_MAGIC 0x315456454D4F44ULL // "DOMEVT1" en memoria (little-endian)
+#define EVT_VERSION 1
+#define EVT_DEFAULT_CAP 65536
+
+typedef enum
+{
+    EV_PLAY = 1,    // player coloca tile_a|tile_b en side; ends = extremos nuevos; value = mano
+    EV_DRAW = 2,    // player roba; value = fichas en el pozo
+    EV_PASS = 3,    // player pasa; value = racha de pases
+    EV_DOMINA = 4,  // fin: player coloca su última ficha; value = pasos
+    EV_BLOCKED = 5, // fin por bloqueo: player = ganador; value = pasos
+    EV_STEP_LIMIT = 6, // fin forzado por límite de pasos; value = pasos
+    EV_END_STREAM = 7  // el productor terminó
+} evt_kind_t;
+
+typedef struct
+{
+    uint64_t magic;
+    uint32_t version, record_size;
+    uint64_t capacity;
+    _Atomic uint64_t head; // registros publicados (índice del siguiente)
+    uint64_t reserved[4];
+} evt_header_t;
+
+typedef struct
+{
+    _Atomic uint64_t seq; // índice + 1 cuando el registro es válido
+    uint64_t ts_ns;       // CLOCK_MONOTONIC del productor
+    int32_t table_id;
+    uint8_t kind, player, tile_a, tile_b;
+    int8_t side;
+    uint8_t left_end, right_end, hand_len;
+    uint16_t steps, value;
+} evt_record_t;
+
+_Static_assert(sizeof(evt_header_t) == 64, "evt_header_t debe medir 64 bytes");
+_Static_assert(sizeof(evt_record_t) == 32, "evt_record_t debe medir 32 bytes");
+
+typedef struct
+{
+    evt_header_t *hdr;
+    evt_record_t *recs;
+    uint64_t mask, next;
+    uint64_t ts_ns; // reloj de la acción en curso (lo fija el validador una vez por acción)
+    size_t map_len;
+    char name[64];
+} event_stream_t;
+
+static event_stream_t EVT; // hdr == NULL => flujo desactivado
+
+static size_t evt_map_len(uint64_t cap)
+{
+    return sizeof(evt_header_t) + sizeof(evt_record_t) * cap;
+}
+
+static int evt_open_producer(const char *name, uint64_t cap)
+{
+    if (cap < 2 || (cap & (cap - 1)) != 0)
+    {
+        fprintf(stderr, "--events-cap debe ser potencia de 2\n");
+        return -1;
+    }
+    shm_unlink(name); // empezar siempre con un segmento limpio
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        perror("shm_open(events)");
+        return -1;
+    }
+    size_t len = evt_map_len(cap);
+    if (ftruncate(fd, (off_t)len) != 0)
+    {
+        perror("ftruncate(events)");
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        perror("mmap(events)");
+        return -1;
+    }
+    EVT.hdr = (evt_header_t *)p;
+    EVT.recs = (evt_record_t *)((char *)p + sizeof(evt_header_t));
+    EVT.mask = cap - 1;
+    EVT.next = 0;
+    EVT.map_len = len;
+    snprintf(EVT.name, sizeof(EVT.name), "%s", name);
+    EVT.hdr->version = EVT_VERSION;
+    EVT.hdr->record_size = sizeof(evt_record_t);
+    EVT.hdr->capacity = cap;
+    atomic_store_explicit(&EVT.hdr->head, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    EVT.hdr->magic = EVT_MAGIC; // último: los lectores esperan a verlo
+    return 0;
+}
+
+static void evt_set_clock(long long ts) { EVT.ts_ns = (uint64_t)ts; }
+
+// solo el validador publica; unas pocas stores, sin lecturas de reloj
+static void evt_publish(int table_id, evt_kind_t kind, int player, tile_t t, int side,
+                        int left_end, int right_end, int hand_len, int steps, int value)
+{
+    if (!EVT.hdr)
+        return;
+    uint64_t i = EVT.next++;
+    evt_record_t *r = &EVT.recs[i & EVT.mask];
+    atomic_store_explicit(&r->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    r->ts_ns = EVT.ts_ns;
+    r->table_id = table_id;
+    r->kind = (uint8_t)kind;
+    r->player = (uint8_t)player;
+    r->tile_a = TILE_LO[t];
+    r->tile_b = TILE_HI[t];
+    r->side = (int8_t)side;
+    r->left_end = (uint8_t)left_end;
+    r->right_end = (uint8_t)right_end;
+    r->hand_len = (uint8_t)hand_len;
+    r->steps = (uint16_t)steps;
+    r->value = (uint16_t)value;
+    atomic_store_explicit(&r->seq, i + 1, memory_order_release);
+    atomic_store_explicit(&EVT.hdr->head, i + 1, memory_order_release);
+}
+
+static void evt_publish_game(game_state_t *g, evt_kind_t kind, int player, int value)
+{
+    tile_t none = 0;
+    evt_publish(g->table_id, kind, player, none, 0, g->left_end, g->right_end,
+                player >= 0 ? g->hand_len[player] : 0, g->steps, value);
+}
+
+static void evt_close_producer(void)
+{
+    if (!EVT.hdr)
+        return;
+    tile_t none = 0;
+    evt_set_clock(now_ns());
+    evt_publish(-1, EV_END_STREAM, 0, none, 0, 0, 0, 0, 0, 0);
+    munmap(EVT.hdr, EVT.map_len);
+    shm_unlink(EVT.name);
+    EVT.hdr = NULL;
+}
+
+/* ----- lector: tail + estadísticas móviles (modo --tail-events) ----- */
+static int evt_tail(const char *name)
+{
+    // el productor puede no haber creado (o terminado de formatear) el segmento aún
+    int fd = -1;
+    evt_header_t h0;
+    for (int tries = 0; tries < 100; tries++)
+    {
+        fd = shm_open(name, O_RDONLY, 0);
+        if (fd >= 0 && pread(fd, &h0, sizeof(h0), 0) == (ssize_t)sizeof(h0) && h0.magic == EVT_MAGIC)
+            break;
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+        sleep_ms(100);
+    }
+    if (fd < 0)
+    {
+        fprintf(stderr, "No se encontró el flujo de eventos %s\n", name);
+        return 1;
+    }
+    if (h0.version != EVT_VERSION || h0.record_size != sizeof(evt_record_t))
+    {
+        fprintf(stderr, "Segmento %s sin formato de eventos v%d\n", name, EVT_VERSION);
+        close(fd);
+        return 1;
+    }
+    size_t len = evt_map_len(h0.capacity);
+    void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        perror("mmap(events)");
+        return 1;
+    }
+    evt_header_t *hdr = (evt_header_t *)p;
+    evt_record_t *recs = (evt_record_t *)((char *)p + sizeof(evt_header_t));
+    uint64_t cap = hdr->capacity, mask = cap - 1;
+    uint64_t pos = atomic_load_explicit(&hdr->head, memory_order_acquire); // tail: desde ahora
+
+    long win_ev = 0, by_kind[8] = {0}, games = 0, game_steps = 0;
+    unsigned long dropped = 0;
+    long long win_start = now_ns();
+    int done = 0;
+    printf("[Eventos] leyendo %s (capacidad %llu registros)\n", name, (unsigned long long)cap);
+
+    while (!done)
+    {
+        uint64_t head = atomic_load_explicit(&hdr->head, memory_order_acquire);
+        if (head - pos > cap)
+        {
+            // lector lento: el productor ya sobrescribió estas ranuras
+            dropped += head - cap - pos;
+            pos = head - cap;
+        }
+        if (pos == head)
             sleep_ms(1);
+        while (pos < head)
+        {
+            evt_record_t *slot = &recs[pos & mask], r;
+            uint64_t s1 = atomic_load_explicit(&slot->seq, memory_order_acquire);
+            memcpy(&r, slot, sizeof(r));
+            atomic_thread_fence(memory_order_acquire);
+            uint64_t s2 = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+            if (s1 != pos + 1 || s2 != s1)
+            {
+                // sobrescrito mientras leíamos: saltar
+                dropped++;
+                pos++;
+                continue;
+            }
+            pos++;
+            win_ev++;
+            if (r.kind < 8)
+                by_kind[r.kind]++;
+            if (r.kind == EV_DOMINA || r.kind == EV_BLOCKED || r.kind == EV_STEP_LIMIT)
+            {
+                games++;
+                game_steps += r.value;
+            }
+            if (r.kind == EV_END_STREAM)
+                done = 1;
+        }
+
+        long long now = now_ns();
+        if (now - win_start >= 1000000000LL || done)
+        {
+            double secs = (now - win_start) / 1e9;
+            printf("[Eventos] %.0f ev/s | juega %ld roba %ld pasa %ld | partidas %ld (domina %ld, bloqueo %ld, límite %ld) "
+                   "pasos/partida %.1f | saltados %lu\n",
+                   secs > 0 ? win_ev / secs : 0.0, by_kind[EV_PLAY], by_kind[EV_DRAW], by_kind[EV_PASS], games,
+                   by_kind[EV_DOMINA], by_kind[EV_BLOCKED], by_kind[EV_STEP_LIMIT],
+                   games ? (double)game_steps / games : 0.0, dropped);
+            win_ev = 0;
+            memset(by_kind, 0, sizeof(by_kind));
+            games = game_steps = 0;
+            win_start = now;
+        }
+    }
+    munmap(p, len);
+    return 0;
+}
+
+/* ===== validador (consumidor) ===== */
+typedef struct
+{
+    game_state_t *tables;
+    int n_tables;
+} validator_args_t;
+
+static void apply_play(game_state_t *g, int pid, tile_t t, int side)
+{
+    TRACE_BEGIN(sp);
+    take_from_hand(g, pid, t);
+    g->played |= TILE_BIT(t);
+    g->train_len++;
+    if (side < 0)
+        g->left_end = tile_other(t, g->left_end);
+    else
+        g->right_end = tile_other(t, g->right_end);
+    g->pass_streak = 0;
+    evt_publish(g->table_id, EV_PLAY, pid, t, side, g->left_end, g->right_end, g->hand_len[pid], g->steps, 0);
+    TLOG("Mesa %d | J%d JUEGA [%d|%d] en %s -> extremos %d-%d (mano %d)\n", g->table_id, pid, TILE_LO[t], TILE_HI[t],
+         side < 0 ? "izq" : "der", g->left_end, g->right_end, g->hand_len[pid]);
+    TRACE_END(sp, "apply_play");
+}
+static void apply_draw(game_state_t *g, int pid)
+{
+    if (g->pool_len <= 0)
+        return;
+    TRACE_BEGIN(sp);
+    tile_t t = g->pool[--g->pool_len];
+    add_to_hand(g, pid, t);
+    g->voids[pid] = 0; // la ficha robada es desconocida para los demás
+    evt_publish_game(g, EV_DRAW, pid, g->pool_len);
+    TLOG("Mesa %d | J%d ROBA 1. Pozo=%d, Mano=%d\n", g->table_id, pid, g->pool_len, g->hand_len[pid]);
+    TRACE_END(sp, "apply_draw");
+}
+static void apply_pass(game_state_t *g, int pid)
+{
+    TRACE_BEGIN(sp);
+    g->pass_streak++;
+    g->voids[pid] |= (uint16_t)(1u << g->left_end | 1u << g->right_end);
+    evt_publish_game(g, EV_PASS, pid, g->pass_streak);
+    TLOG("Mesa %d | J%d PASA. (racha=%d)\n", g->table_id, pid, g->pass_streak);
+    if (g->pool_len == 0 && g->pass_streak >= g->nplayers)
+    {
+        print_points_table(g);
+        int win = winner_lowest_points(g);
+        TLOG("=== Mesa %d | CIERRE por bloqueo. Gana J%d ===\n", g->table_id, win);
+        g->winner = win;
+        g->end_reason = END_BLOCKED;
+        evt_publish_game(g, EV_BLOCKED, win, g->steps + 1);
+        g->finished = 1;
+    }
+    TRACE_END(sp, "apply_pass");
+}
+
+void *validator_thread(void *arg)
+{
+    validator_args_t *va = (validator_args_t *)arg;
+    game_state_t *tables = va->tables;
+    int N = va->n_tables;
+    TRACE_THREAD("validador");
+
+    for (;;)
+    {
+        action_t act;
+        int have = 0;
+        TRACE_BEGIN(pop);
+        if (!(have = q_pop(&GQ, &act)))
+            return NULL; // cola vacía y todas las mesas terminadas
+        TRACE_END(pop, "esperar_cola");
+        long long now = now_ns();
+        bp_on_dequeue(&act, now);
+        evt_set_clock(now);
+        if (act.table_id < 0 || act.table_id >= N)
+            continue;
+        game_state_t *g = &tables[act.table_id];
+
+        TRACE_BEGIN(lk);
+        MTX_LOCK(&g->mtx, "mesa");
+        TRACE_END(lk, "lock_mesa");
+        if (g->finished)
+        {
+            MTX_UNLOCK(&g->mtx);
+            continue;
+        }
+        if (g->turn != act.player_id)
+        {
+            MTX_UNLOCK(&g->mtx);
+            continue;
+        }
+
+        // aplicar una única acción
+        if (!FIRST_MOVE_NS)
+            FIRST_MOVE_NS = now;
+        TRACE_BEGIN(ap);
+        if (act.kind == ACT_PLAY)
+        {
+            if (g->hands[act.player_id] & TILE_BIT(act.tile))
+            {
+                int ok = tile_fits(act.tile, act.side < 0 ? g->left_end : g->right_end);
+                if (ok)
+                {
+                    apply_play(g, act.player_id, act.tile, act.side);
+                    // pass_streak=0 está dentro de apply_play ✓
+                    if (g->hand_len[act.player_id] == 0)
+                    {
+                        TLOG("=== Mesa %d | J%d DOMINA. FIN ===\n", g->table_id, act.player_id);
+                        g->winner = act.player_id;
+                        g->end_reason = END_DOMINA;
+                        evt_publish_game(g, EV_DOMINA, act.player_id, g->steps + 1);
+                        g->finished = 1;
+                    }
+                }
+                else
+                {
+                    // Jugada inválida: no resetear pass_streak aquí
+                    if (g->pool_len > 0)
+                        apply_draw(g, act.player_id);
+                    else
+                        apply_pass(g, act.player_id);
+                }
+            }
+        }
+        else if (act.kind == ACT_DRAW)
+        {
+            if (g->pool_len > 0)
+                apply_draw(g, act.player_id);
+            else
+                apply_pass(g, act.player_id);
+        }
+        else if (act.kind == ACT_PASS)
+        {
+            apply_pass(g, act.player_id);
+        }
+
+        g->steps++;
+        if (!g->finished && g->steps >= MAX_STEPS)
+        {
+            TLOG("=== Mesa %d | FIN forzado por límite de pasos ===\n", g->table_id);
+            g->end_reason = END_STEP_LIMIT;
+            evt_publish_game(g, EV_STEP_LIMIT, -1, g->steps);
+            g->finished = 1;
+        }
+
+        g->turn_lat_sum_ns += now - g->turn_open_ns - g->turn_delay_ns;
+        lat_hist_add(&TURN_HIST, now - g->turn_open_ns - g->turn_delay_ns);
+        lat_hist_add(&START_HIST, act.enq_ns - g->turn_open_ns - g->turn_delay_ns);
+
+        // marcar fin de "turno planificado" y notificar
+        timer_cancel(&g->t_quantum);
+        g->action_done = 1;
+        snapshot_publish(g);
+        pthread_cond_broadcast(&g->cv);
+        MTX_UNLOCK(&g->mtx);
+        TRACE_END(ap, "aplicar");
+    }
+    return NULL;
+}
+
+/* ===== control en caliente (consola) ===== */
+
+void *control_thread(void *arg)
+{
+    control_args_t *ca = (control_args_t *)arg;
+
+    TLOG("\n[Supervisor automático] Iniciando monitoreo de mesas...\n");
+
+    while (!comp_all_done())
+    {
+        for (int i = 0; i < ca->n_tables; ++i)
+        {
+            game_state_t *g = &ca->tables[i];
+            policy_t desired_policy = FCFS;
+            int request_change = 0;
+
+            // decisión sobre la instantánea: sin competir con el validador por g->mtx
+            table_summary_t sum;
+            snapshot_read(g, &sum);
+            if (sum.finished || sum.nplayers == 0)
+                continue;
+
+            // con política fija solo se ajustan cooldown y quantum
+            if (g->auto_policy)
+            {
+                if (evaluate_auto_policy(&sum, &desired_policy) && desired_policy != sum.policy)
+                    request_change = 1;
+                else if (sum.policy == FCFS)
+                {
+                    desired_policy = (sum.nplayers >= 3) ? SJF_PLAYERS : SJF_POINTS;
+                    request_change = 1;
+                }
+            }
+
+            if (request_change)
+                request_policy_change(i, desired_policy);
+
+            int desired_cooldown = CFG.turn_cooldown_ms + bp_cooldown_ms(i) +
+                                   ((sum.pass_streak >= sum.nplayers) ? CFG.blocked_cooldown_ms : 0);
+            int desired_quantum = (sum.policy == RR) ? CFG.quantum_ms : CFG.idle_quantum_ms;
+            if (sum.turn_cooldown_ms == desired_cooldown && sum.rr_quantum_ms == desired_quantum)
+                continue;
+
+            // solo se bloquea la mesa cuando hay algo que escribir
+            MTX_LOCK(&g->mtx, "mesa");
+            if (!g->finished)
+            {
+                if (g->turn_cooldown_ms != desired_cooldown)
+                {
+                    g->turn_cooldown_ms = desired_cooldown;
+                    TLOG(">> Supervisor auto: Mesa %d ajusta cooldown = %d ms\n", i, desired_cooldown);
+                    pthread_cond_broadcast(&g->cv);
+                }
+
+                if (g->rr_quantum_ms != desired_quantum)
+                {
+                    g->rr_quantum_ms = desired_quantum;
+                    TLOG(">> Supervisor auto: Mesa %d ajusta quantum = %d ms\n", i, desired_quantum);
+                }
+                snapshot_publish(g);
+            }
+            MTX_UNLOCK(&g->mtx);
+        }
+
+        comp_wait_ms(CFG.supervisor_ms);
+    }
+
+    TLOG("[Supervisor automático] Finalizó el monitoreo: todas las mesas terminaron.\n");
+    return NULL;
+}
+
+/* ===== controlador de contrapresión + reporte periódico ===== */
+void *backpressure_thread(void *arg)
+{
+    (void)arg;
+    long long next_stats = now_ns() + (long long)CFG.stats_ms * 1000000LL;
+
+    while (!comp_all_done())
+    {
+        if (BP.enabled)
+            bp_tick();
+        if (CFG.stats_ms > 0 && now_ns() >= next_stats)
+        {
+            print_stats();
+            next_stats += (long long)CFG.stats_ms * 1000000LL;
+        }
+        comp_wait_ms(CFG.bp_tick_ms);
+    }
+    return NULL;
+}
+
+/* ===== consola de control y monitor (lectores de instantáneas) ===== */
+static void print_summary_line(int table_id, const table_summary_t *s)
+{
+    if (s->nplayers == 0)
+    {
+        printf("Mesa %d | sin iniciar\n", table_id);
+        return;
+    }
+    printf("Mesa %d | %-11s | turno J%d | extremos %d-%d | pozo %2d | racha %d | pasos %3d | q=%d cd=%d | manos",
+           table_id, policy_name(s->policy), s->turn, s->left_end, s->right_end, s->pool_len,
+           s->pass_streak, s->steps, s->rr_quantum_ms, s->turn_cooldown_ms);
+    for (int p = 0; p < s->nplayers; p++)
+        printf(" J%d:%d/%dpts", p, s->hand_len[p], s->points[p]);
+    printf("%s\n", s->finished ? " | TERMINADA" : "");
+}
+
+#define SHOW_MAX_LINES 32
+
+static void console_show(game_state_t *tables, int n_tables, int only)
+{
+    table_summary_t s;
+    if (only >= 0)
+    {
+        snapshot_read(&tables[only], &s);
+        print_summary_line(only, &s);
+        return;
+    }
+    int active = 0;
+    for (int i = 0; i < n_tables; i++)
+    {
+        snapshot_read(&tables[i], &s);
+        active += !s.finished;
+        if (i < SHOW_MAX_LINES)
+            print_summary_line(i, &s);
+    }
+    if (n_tables > SHOW_MAX_LINES)
+        printf("... (%d mesas más; usa 'show <mesa>')\n", n_tables - SHOW_MAX_LINES);
+    printf("Mesas activas: %d/%d\n", active, n_tables);
+}
+
+// aplica fn a la mesa indicada o a todas ("all")
+static int parse_table_target(const char *s, int n_tables, int *first, int *last)
+{
+    if (strcasecmp(s, "all") == 0)
+    {
+        *first = 0;
+        *last = n_tables;
+        return 1;
+    }
+    char *end;
+    long id = strtol(s, &end, 10);
+    if (end == s || *end || id < 0 || id >= n_tables)
+        return 0;
+    *first = (int)id;
+    *last = (int)id + 1;
+    return 1;
+}
+
+void *console_thread(void *arg)
+{
+    control_args_t *ca = (control_args_t *)arg;
+    char line[256];
+
+    for (;;)
+    {
+        lk_flush(); // este hilo no termina: vuelca sus esperas antes de bloquearse
+        if (!fgets(line, sizeof(line), stdin))
+            break;
+        char cmd[32] = "", a1[32] = "", a2[32] = "";
+        int n = sscanf(line, "%31s %31s %31s", cmd, a1, a2);
+        if (n <= 0)
+            continue;
+
+        int first, last;
+        if (strcmp(cmd, "show") == 0)
+        {
+            int only = -1;
+            if (n >= 2 && !parse_table_target(a1, ca->n_tables, &only, &last))
+            {
+                printf("Mesa inválida: %s\n", a1);
+                continue;
+            }
+            console_show(ca->tables, ca->n_tables, n >= 2 && strcasecmp(a1, "all") != 0 ? only : -1);
+        }
+        else if (strcmp(cmd, "stats") == 0)
+        {
+            print_stats();
+        }
+        else if (strcmp(cmd, "policy") == 0 && n == 3)
+        {
+            policy_t p;
+            if (!parse_table_target(a1, ca->n_tables, &first, &last) || !parse_policy(a2, &p))
+            {
+                puts("Uso: policy <mesa|all> <FCFS|RR|SJF_POINTS|SJF_PLAYERS>");
+                continue;
+            }
+            if (strcasecmp(a1, "all") == 0)
+                printf("Política global %s publicada (época %u)\n", policy_name(p), gcfg_publish(1, p, 0, 0));
+            else
+                request_policy_change(first, p);
+        }
+        else if (strcmp(cmd, "quantum") == 0 && n == 3)
+        {
+            int ms = atoi(a2);
+            if (!parse_table_target(a1, ca->n_tables, &first, &last) || ms <= 0)
+            {
+                puts("Uso: quantum <mesa|all> <ms>");
+                continue;
+            }
+            if (strcasecmp(a1, "all") == 0)
+                printf("Quantum global %d ms publicado (época %u)\n", ms, gcfg_publish(0, FCFS, 1, ms));
+            else
+                request_quantum_change(first, ms);
+        }
+        else
+        {
+            puts("Comandos: show [mesa|all] | stats | policy <mesa|all> <POLÍTICA> | quantum <mesa|all> <ms>");
+        }
+    }
+    return NULL;
+}
+
+// resumen agregado periódico, solo con lecturas de instantáneas
+void *monitor_thread(void *arg)
+{
+    control_args_t *ca = (control_args_t *)arg;
+    while (!comp_wait_ms(CFG.monitor_ms))
+    {
+        int active = 0, blocked = 0, by_policy[4] = {0};
+        long steps = 0;
+        for (int i = 0; i < ca->n_tables; i++)
+        {
+            table_summary_t s;
+            snapshot_read(&ca->tables[i], &s);
+            steps += s.steps;
+            if (s.finished || s.nplayers == 0)
+                continue;
+            active++;
+            blocked += s.pass_streak > 0;
+            by_policy[s.policy]++;
+        }
+        printf("[Monitor] activas=%d/%d pasos=%ld con_pases=%d | FCFS=%d SJF_PLAYERS=%d SJF_POINTS=%d RR=%d\n",
+               active, ca->n_tables, steps, blocked, by_policy[FCFS], by_policy[SJF_PLAYERS],
+               by_policy[SJF_POINTS], by_policy[RR]);
+    }
+    return NULL;
+}
+
+typedef struct
+{
+    game_state_t *tables;
+    int n_tables;
+} policy_supervisor_args_t;
+
+void *policy_supervisor_thread(void *arg)
+{
+    policy_supervisor_args_t *psa = (policy_supervisor_args_t *)arg;
+
+    int stop_requested = 0;
+    for (;;)
+    {
+        policy_change_t change;
+        int popped = policy_q_try_pop(&POLICY_Q, &change);
+        if (popped == 1)
+        {
+            if (change.table_id < 0 || change.table_id >= psa->n_tables)
+                continue;
+
+            game_state_t *g = &psa->tables[change.table_id];
+            MTX_LOCK(&g->mtx, "mesa");
+            if (!g->finished)
+            {
+                // ponerse al día con lo global; luego el cambio propio, salvo que
+                // lo global del mismo campo sea posterior a la petición
+                gcfg_pickup(g);
+                global_cfg_t *c = atomic_load_explicit(&GCFG.cur, memory_order_acquire);
+                if (c && c->policy_epoch > change.epoch)
+                    change.change_policy = 0;
+                if (c && c->quantum_epoch > change.epoch)
+                    change.change_quantum = 0;
+                if (change.change_policy)
+                    supervisor_apply_policy_change(g, change.new_policy, " (solicitado)");
+                if (change.change_quantum && g->rr_quantum_ms != change.new_quantum_ms)
+                {
+                    g->rr_quantum_ms = change.new_quantum_ms;
+                    TLOG(">> Supervisor (solicitado): Mesa %d ajusta quantum = %d ms\n",
+                           g->table_id, g->rr_quantum_ms);
+                    snapshot_publish(g);
+                }
+            }
+            MTX_UNLOCK(&g->mtx);
+            continue;
+        }
+        if (popped == -1)
+            stop_requested = 1;
+        if (stop_requested && comp_all_done())
+            break;
+
+        sleep_ms(CFG.policy_poll_ms);
+    }
+
+    return NULL;
+}
+
+/* ===== planificador por mesa ===== */
+static int pick_next_fcfs(game_state_t *g, int current)
+{
+    return (current + 1) % g->nplayers;
+}
+static int pick_next_rr(game_state_t *g, int current)
+{
+    // por ahora 1 acción por turno => igual a FCFS; luego podemos permitir N acciones por quantum
+    (void)g;
+    return (current + 1) % g->nplayers;
+}
+static int pick_next_sjf_points(game_state_t *g)
+{
+    int best = -1, best_pts = INT_MAX, best_tiles = INT_MAX;
+    for (int p = 0; p < g->nplayers; p++)
+    {
+        int pts = hand_points(g, p), tiles = g->hand_len[p];
+        if (pts < best_pts || (pts == best_pts && tiles < best_tiles) || (pts == best_pts && tiles == best_tiles && p < best))
+        {
+            best = p;
+            best_pts = pts;
+            best_tiles = tiles;
+        }
+    }
+    return best;
+}
+static int pick_next_sjf_players(game_state_t *g)
+{
+    int best = -1, best_tiles = INT_MAX;
+    for (int p = 0; p < g->nplayers; p++)
+    {
+        int tiles = g->hand_len[p];
+        if (tiles < best_tiles || (tiles == best_tiles && p < best))
+        {
+            best = p;
+            best_tiles = tiles;
+        }
+    }
+    return best;
+}
+static int pick_next_player(game_state_t *g, int current)
+{
+    switch (g->policy)
+    {
+    case FCFS:
+        return pick_next_fcfs(g, current);
+    case RR:
+        return pick_next_rr(g, current);
+    case SJF_POINTS:
+        return pick_next_sjf_points(g);
+    case SJF_PLAYERS:
+        return pick_next_sjf_players(g);
+    }
+    return (current + 1) % g->nplayers;
+}
+
+/* ----- plazos del turno (rueda de temporizadores) ----- */
+// quantum agotado sin acción del jugador: pierde el turno (roba o pasa)
+static void on_quantum(void *arg)
+{
+    game_state_t *g = (game_state_t *)arg;
+    MTX_LOCK(&g->mtx, "mesa");
+    if (!g->finished && !g->action_done && g->turn_ready && !g->turn_submitted && now_ns() >= g->quantum_at_ns)
+    {
+        action_t forced = {.table_id = g->table_id, .player_id = g->turn,
+                           .kind = g->pool_len > 0 ? ACT_DRAW : ACT_PASS};
+        g->turn_submitted = 2;
+        g->perturbed = 1;
+        TLOG("Mesa %d | J%d agota el quantum (%d ms): %s\n", g->table_id, g->turn, g->rr_quantum_ms,
+             forced.kind == ACT_DRAW ? "roba" : "pasa");
+        atomic_fetch_add(&QUANTUM_EXPIRED, 1);
+        bp_admit_force();
+        q_push(&GQ, forced);
+        pthread_cond_broadcast(&g->cv);
+    }
+    MTX_UNLOCK(&g->mtx);
+}
+
+// el turno abierto pasa a estar listo; en RR arranca el quantum; requiere g->mtx
+static void turn_ready_locked(game_state_t *g)
+{
+    g->turn_ready = 1;
+    if (g->policy == RR && g->rr_quantum_ms > 0)
+    {
+        g->quantum_at_ns = now_ns() + (long long)g->rr_quantum_ms * 1000000LL;
+        timer_arm(&g->t_quantum, (long long)g->rr_quantum_ms * 1000000LL, on_quantum, g);
+    }
+}
+
+static void on_turn_ready(void *arg)
+{
+    game_state_t *g = (game_state_t *)arg;
+    MTX_LOCK(&g->mtx, "mesa");
+    long long now = now_ns();
+    if (!g->finished && !g->action_done && !g->turn_ready && now >= g->ready_at_ns)
+    {
+        g->turn_delay_ns += now - g->turn_open_ns; // el cooldown no cuenta como latencia
+        turn_ready_locked(g);
+        pthread_cond_broadcast(&g->cv);
+    }
+    MTX_UNLOCK(&g->mtx);
+}
+
+// el hilo del jugador se crea al abrirse su primer turno, no al arrancar la mesa
+static void spawn_player(game_state_t *g, int p)
+{
+    if (g->spawned & (1u << p))
+        return;
+    player_args_t *pa = malloc(sizeof(*pa));
+    pa->g = g;
+    pa->pid = p;
+    if (pthread_create(&g->th_players[p], NULL, player_thread, pa) != 0)
+    {
+        perror("pthread_create(player)");
+        exit(1);
+    }
+    g->spawned |= 1u << p;
+}
+
+void *scheduler_thread(void *arg)
+{
+    game_state_t *g = (game_state_t *)arg;
+
+    TRACE_THREAD("planificador");
+    MTX_LOCK(&g->mtx, "mesa");
+    int current = g->turn; // ya viene inicializado por choose_opening
+
+    // g->mtx solo se suelta al esperar: elegir al siguiente y abrir su turno
+    // ocurre sin que nadie vea el estado intermedio, así que con action_done
+    // a 1 g->turn es siempre quien acaba de actuar (lo usa la especulación)
+    while (!g->finished)
+    {
+        // programar al 'current': despertar jugadores
+        g->action_done = 0;
+        g->turn_seq++;
+        g->turn_open_ns = now_ns();
+        g->turn_delay_ns = 0;
+        g->turn_submitted = 0;
+        gcfg_pickup(g); // cambios globales publicados desde el turno anterior
+        spawn_player(g, current); // aún sin hilo si es su primer turno
+        // g->turn ya apunta a current; el cooldown es un plazo en la rueda,
+        // no un hilo dormido
+        if (g->turn_cooldown_ms > 0)
+        {
+            g->turn_ready = 0;
+            g->ready_at_ns = g->turn_open_ns + (long long)g->turn_cooldown_ms * 1000000LL;
+            timer_arm(&g->t_ready, g->ready_at_ns - g->turn_open_ns, on_turn_ready, g);
+        }
+        else
+            turn_ready_locked(g);
+        pthread_cond_broadcast(&g->cv);
+
+        // esperar a que el validador aplique UNA acción
+        TRACE_BEGIN(turn);
+        while (!g->finished && !g->action_done)
+            CV_WAIT(&g->cv, &g->mtx);
+        TRACE_END(turn, "turno");
+        if (g->finished)
+            break;
+
+        // decidir siguiente según política
+        TRACE_BEGIN(pick);
+        int next = pick_next_player(g, current);
+        g->turn = next;
+        current = next;
+        snapshot_publish(g);
+        TRACE_END(pick, "elegir_siguiente");
+    }
+    MTX_UNLOCK(&g->mtx);
+    return NULL;
+}
+
+/* ===== caché de resultados (--outcome-cache) =====
+ * Con estrategia first y política fija una mesa es determinista: el mismo
+ * reparto con la misma política acaba siempre igual. La clave es un hash de
+ * 128 bits del estado tras la apertura (juego de fichas, jugadores, política,
+ * abridor, extremos, manos y pozo en orden) y el valor, el resultado final. La tabla
+ * es asociativa de OC_WAYS vías con reemplazo LRU dentro de cada conjunto y
+ * un lock por franja de conjuntos. Solo se guardan partidas que nada externo
+ * perturbó (cambio de política solicitado o acción forzada por quantum). En
+ * un acierto la mesa termina sin lanzar jugadores ni planificador, así que no
+ * aporta turnos a la latencia ni registros al flujo de eventos.
+ */
+#define OC_WAYS 4
+#define OC_STRIPES 64
+#define OC_FILE_MAGIC 0x3143304d4f44ULL // "DOM0C1"
+#define OC_RULES_VERSION 3              // subir si cambian las reglas o la estrategia first
+
+typedef struct
+{
+    uint64_t h[2]; // {0, 0} => ranura vacía
+} oc_key_t;
+
+typedef struct
+{
+    oc_key_t key;
+    uint64_t last_use; // reloj lógico para LRU
+    int8_t winner;
+    uint8_t end_reason;
+    uint16_t steps;
+    uint16_t points[MAX_PLAYERS];
+} oc_entry_t;
+
+static struct
+{
+    oc_entry_t *e; // n_sets * OC_WAYS; NULL => caché desactivada
+    uint32_t n_sets;    // potencia de 2
+    pthread_mutex_t mtx[OC_STRIPES];
+    atomic_ulong clock;
+    atomic_long hits, misses, stores, evictions, skipped, used;
+} OC;
+
+static uint64_t oc_mix(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void oc_init(long entries)
+{
+    uint32_t sets = 1;
+    while ((long)sets * OC_WAYS < entries && sets < (1u << 30))
+        sets <<= 1;
+    OC.e = calloc((size_t)sets * OC_WAYS, sizeof(oc_entry_t));
+    if (!OC.e)
+    {
+        perror("alloc outcome cache");
+        exit(1);
+    }
+    OC.n_sets = sets;
+    for (int i = 0; i < OC_STRIPES; i++)
+        pthread_mutex_init(&OC.mtx[i], NULL);
+}
+
+// solo se consulta la caché si la partida no depende del reloj ni del azar de PIMC
+static int oc_cacheable(game_state_t *g)
+{
+    if (!OC.e || g->auto_policy)
+        return 0;
+    for (int p = 0; p < g->nplayers; p++)
+        if (pimc_seat(p))
+            return 0;
+    return 1;
+}
+
+// estado canónico tras la apertura, 7 bits por ficha (índice en el doble-12)
+static oc_key_t oc_key(game_state_t *g, int opener)
+{
+    uint64_t h0 = 0x243f6a8885a308d3ULL, h1 = 0x13198a2e03707344ULL, w = 0;
+    int bits = 0;
+#define OC_FEED(v, nb)                                     \
+    do                                                     \
+    {                                                      \
+        w = (w << (nb)) | (uint64_t)(v);                   \
+        bits += (nb);                                      \
+        if (bits > 64 - 8)                                 \
+        {                                                  \
+            h0 = oc_mix(h0 ^ w);                           \
+            h1 = oc_mix(h1 + w * 0x9e3779b97f4a7c15ULL);   \
+            w = 0;                                         \
+            bits = 0;                                      \
+        }                                                  \
+    } while (0)
+    OC_FEED(OC_RULES_VERSION, 8);
+    OC_FEED(CFG.pips, 4);
+    OC_FEED(g->nplayers, 4);
+    OC_FEED(g->policy, 4);
+    OC_FEED(opener, 4);
+    OC_FEED(g->left_end, 4);
+    OC_FEED(g->right_end, 4);
+    for (int p = 0; p < g->nplayers; p++)
+    {
+        OC_FEED(g->hand_len[p], 7);
+        for (tmask_t m = g->hands[p]; m; m &= m - 1)
+            OC_FEED(tmask_ctz(m), 7);
+    }
+    OC_FEED(g->pool_len, 7);
+    for (int i = 0; i < g->pool_len; i++)
+        OC_FEED(g->pool[i], 7);
+#undef OC_FEED
+    h0 = oc_mix(h0 ^ w ^ (uint64_t)bits << 56);
+    h1 = oc_mix(h1 + w * 0x9e3779b97f4a7c15ULL);
+    oc_key_t k = {{h0 | 1, h1}}; // nunca {0, 0}
+    return k;
+}
+
+static int oc_key_eq(const oc_key_t *a, const oc_key_t *b) { return a->h[0] == b->h[0] && a->h[1] == b->h[1]; }
+
+static int oc_lookup(const oc_key_t *k, oc_entry_t *out)
+{
+    uint32_t set = (uint32_t)k->h[1] & (OC.n_sets - 1);
+    oc_entry_t *ways = &OC.e[(size_t)set * OC_WAYS];
+    int found = 0;
+    MTX_LOCK(&OC.mtx[set % OC_STRIPES], "cache");
+    for (int w = 0; w < OC_WAYS; w++)
+        if (oc_key_eq(&ways[w].key, k))
+        {
+            ways[w].last_use = atomic_fetch_add(&OC.clock, 1) + 1;
+            *out = ways[w];
+            found = 1;
+            break;
+        }
+    MTX_UNLOCK(&OC.mtx[set % OC_STRIPES]);
+    atomic_fetch_add(found ? &OC.hits : &OC.misses, 1);
+    return found;
+}
+
+// inserta o reemplaza; sin hueco libre expulsa la vía menos usada del conjunto
+static void oc_insert(const oc_entry_t *val)
+{
+    uint32_t set = (uint32_t)val->key.h[1] & (OC.n_sets - 1);
+    oc_entry_t *ways = &OC.e[(size_t)set * OC_WAYS];
+    MTX_LOCK(&OC.mtx[set % OC_STRIPES], "cache");
+    int victim = 0;
+    for (int w = 0; w < OC_WAYS; w++)
+    {
+        if (oc_key_eq(&ways[w].key, &val->key) || (ways[w].key.h[0] == 0 && ways[w].key.h[1] == 0))
+        {
+            victim = w;
+            break;
+        }
+        if (ways[w].last_use < ways[victim].last_use)
+            victim = w;
+    }
+    if (ways[victim].key.h[0] == 0 && ways[victim].key.h[1] == 0)
+        atomic_fetch_add(&OC.used, 1);
+    else if (!oc_key_eq(&ways[victim].key, &val->key))
+        atomic_fetch_add(&OC.evictions, 1);
+    ways[victim] = *val;
+    ways[victim].last_use = atomic_fetch_add(&OC.clock, 1) + 1;
+    MTX_UNLOCK(&OC.mtx[set % OC_STRIPES]);
+}
+
+static void oc_store(const oc_key_t *k, game_state_t *g)
+{
+    oc_entry_t v = {.key = *k, .winner = (int8_t)g->winner, .end_reason = (uint8_t)g->end_reason,
+                    .steps = (uint16_t)g->steps};
+    for (int p = 0; p < g->nplayers; p++)
+        v.points[p] = (uint16_t)hand_points(g, p);
+    oc_insert(&v);
+    atomic_fetch_add(&OC.stores, 1);
+}
+
+/* ----- persistencia (--outcome-cache-file) -----
+ * Cabecera {magic, versión de reglas, entradas, tamaño de registro} y las
+ * entradas ocupadas tal cual (mismo binario, misma máquina). Un fichero de
+ * otra versión de reglas se ignora.
+ */
+static void oc_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return; // primera ejecución: aún no existe
+    uint64_t hdr[4];
+    long n = 0;
+    if (fread(hdr, sizeof(hdr), 1, f) == 1 && hdr[0] == OC_FILE_MAGIC && hdr[1] == OC_RULES_VERSION &&
+        hdr[3] == sizeof(oc_entry_t))
+    {
+        oc_entry_t v;
+        for (uint64_t i = 0; i < hdr[2] && fread(&v, sizeof(v), 1, f) == 1; i++, n++)
+            oc_insert(&v);
+    }
+    else
+        fprintf(stderr, "%s: caché de resultados con otro formato; se ignora\n", path);
+    fclose(f);
+    printf("[Caché] %ld resultados cargados de %s\n", n, path);
+}
+
+static void oc_save(const char *path)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        perror("fopen outcome cache");
+        return;
+    }
+    uint64_t hdr[4] = {OC_FILE_MAGIC, OC_RULES_VERSION, (uint64_t)atomic_load(&OC.used), sizeof(oc_entry_t)};
+    fwrite(hdr, sizeof(hdr), 1, f);
+    for (size_t i = 0; i < (size_t)OC.n_sets * OC_WAYS; i++)
+        if (OC.e[i].key.h[0] != 0 || OC.e[i].key.h[1] != 0)
+            fwrite(&OC.e[i], sizeof(oc_entry_t), 1, f);
+    if (fclose(f) != 0)
+        perror("fclose outcome cache");
+}
+
+static void oc_print_stats(void)
+{
+    if (!OC.e)
+        return;
+    long h = atomic_load(&OC.hits), m = atomic_load(&OC.misses);
+    printf("[Stats] caché de resultados: aciertos=%ld (%.1f%%) fallos=%ld guardados=%ld expulsados=%ld "
+           "no cacheables=%ld ocupación=%ld/%ld\n",
+           h, h + m ? 100.0 * h / (h + m) : 0.0, m, atomic_load(&OC.stores), atomic_load(&OC.evictions),
+           atomic_load(&OC.skipped), atomic_load(&OC.used), (long)OC.n_sets * OC_WAYS);
+}
+
+/* ===== mesa ===== */
+// lo que hace falta para arrancar una mesa; viaja también por el socket del modo distribuido
+typedef struct
+{
+    int32_t gid;
+    uint32_t seed;
+    uint8_t nplayers, policy, auto_policy, pad;
+} table_spec_t;
+
+// resultado final de una mesa; viaja también por el socket del modo distribuido
+typedef struct
+{
+    int32_t gid;
+    uint32_t seed;
+    uint8_t nplayers, policy, end_reason;
+    int8_t winner;
+    uint16_t steps, cached; // cached: resultado de la caché, sin latencia medida
+    uint8_t init_policy, switches;
+    uint16_t points[MAX_PLAYERS];
+    uint32_t duration_us;
+    uint32_t turn_mean_ns; // latencia de turno media (saturada a 4.29 s)
+} table_result_t;
+
+// se invoca al terminar cada mesa (desde su hilo); NULL => nadie escucha
+static void (*RESULT_HOOK)(const table_result_t *r);
+static void rs_append(const table_result_t *r); // almacén de resultados, más abajo
+
+static void result_publish(const table_result_t *r)
+{
+    rs_append(r);
+    if (RESULT_HOOK)
+        RESULT_HOOK(r);
+}
+
+/* Cola de finalización: cada mesa deja su resultado en la entrada que le toca
+ * por orden de llegada (ticket atómico, anillo del tamaño del arreglo de
+ * mesas) y descuenta el latch; el recolector de run_simulation las consume en
+ * ese mismo orden, une el hilo, publica y devuelve la ranura de la mesa a la
+ * lista libre. Como cada entrada pendiente retiene su ranura, nunca hay más
+ * entradas pendientes que ranuras y el anillo no se llena. Con la lista libre
+ * una simulación puede jugar más mesas que ranuras tiene (modo distribuido).
+ */
+typedef struct
+{
+    pthread_t th;
+    int slot; // índice en el arreglo de mesas
+    table_result_t r;
+    _Atomic uint8_t ready;
+} finish_entry_t;
+
+static struct
+{
+    finish_entry_t *e;
+    int cap;
+    atomic_uint tail; // siguiente ticket a reservar
+    unsigned head;    // siguiente ticket a consumir (solo el recolector)
+    int *free_slot;   // ranuras ya recogidas (COMP.mtx)
+    int n_free;
+} FQ;
+
+static int fq_init(int cap)
+{
+    FQ.e = calloc(cap > 0 ? cap : 1, sizeof(finish_entry_t));
+    FQ.free_slot = malloc(sizeof(int) * (cap > 0 ? cap : 1));
+    FQ.cap = cap > 0 ? cap : 1;
+    atomic_store(&FQ.tail, 0);
+    FQ.head = 0;
+    FQ.n_free = 0;
+    return FQ.e && FQ.free_slot ? 0 : -1;
+}
+
+static void fq_destroy(void)
+{
+    free(FQ.e);
+    free(FQ.free_slot);
+    FQ.e = NULL;
+    FQ.free_slot = NULL;
+}
+
+// ranura libre para la siguiente mesa: espera a que el recolector devuelva una
+static int fq_take_slot(void)
+{
+    MTX_LOCK(&COMP.mtx, "fin");
+    while (FQ.n_free == 0)
+        CV_WAIT(&COMP.cv, &COMP.mtx);
+    int slot = FQ.free_slot[--FQ.n_free];
+    MTX_UNLOCK(&COMP.mtx);
+    return slot;
+}
+
+// desde el hilo de la mesa, como último paso
+static void fq_push(int slot, const table_result_t *r)
+{
+    finish_entry_t *e = &FQ.e[atomic_fetch_add(&FQ.tail, 1) % (unsigned)FQ.cap];
+    e->th = pthread_self();
+    e->slot = slot;
+    e->r = *r;
+    atomic_store_explicit(&e->ready, 1, memory_order_release);
+    atomic_fetch_sub(&COMP.running, 1); // comp_release difunde: libera el hueco de --max-running
+    comp_release(1);
+}
+
+// 1 => entrada en *out; 0 => todas las mesas terminaron y no queda nada
+static int fq_pop(finish_entry_t *out)
+{
+    finish_entry_t *e = &FQ.e[FQ.head % (unsigned)FQ.cap];
+    MTX_LOCK(&COMP.mtx, "fin");
+    for (;;)
+    {
+        if (atomic_load_explicit(&e->ready, memory_order_acquire))
+            break;
+        // el latch se abre tras el último ready: si ya está abierto y la entrada sigue vacía, no hay más
+        if (comp_all_done() && !atomic_load(&e->ready))
+        {
+            MTX_UNLOCK(&COMP.mtx);
+            return 0;
+        }
+        CV_WAIT(&COMP.cv, &COMP.mtx);
+    }
+    MTX_UNLOCK(&COMP.mtx);
+    *out = *e;
+    atomic_store(&e->ready, 0); // la ranura de la mesa sigue retenida hasta fq_free_slot
+    FQ.head++;
+    return 1;
+}
+
+static void fq_free_slot(int slot)
+{
+    MTX_LOCK(&COMP.mtx, "fin");
+    FQ.free_slot[FQ.n_free++] = slot;
+    pthread_cond_broadcast(&COMP.cv);
+    MTX_UNLOCK(&COMP.mtx);
+}
+
+// recolector: une cada mesa y publica su resultado en orden de finalización
+static void *reaper_thread(void *arg)
+{
+    (void)arg;
+    finish_entry_t e;
+    while (fq_pop(&e))
+    {
+        pthread_join(e.th, NULL);
+        result_publish(&e.r);
+        fq_free_slot(e.slot);
+    }
+    return NULL;
+}
+
+static void fill_result(game_state_t *g, table_result_t *r)
+{
+    memset(r, 0, sizeof(*r));
+    r->gid = g->gid;
+    r->seed = g->seed;
+    r->nplayers = (uint8_t)g->nplayers;
+    r->policy = (uint8_t)g->policy;
+    r->init_policy = g->init_policy;
+    r->switches = g->switches;
+    r->end_reason = (uint8_t)g->end_reason;
+    r->winner = (int8_t)g->winner;
+    r->steps = (uint16_t)g->steps;
+    for (int p = 0; p < g->nplayers; p++)
+        r->points[p] = (uint16_t)hand_points(g, p);
+    r->duration_us = (uint32_t)((g->end_ns - g->start_ns) / 1000);
+    long long mean = g->steps ? g->turn_lat_sum_ns / g->steps : 0;
+    r->turn_mean_ns = mean > UINT32_MAX ? UINT32_MAX : (uint32_t)mean;
+}
+
+static void init_table(game_state_t *g, int table_id, const table_spec_t *spec)
+{
+    memset(g, 0, sizeof(*g));
+    g->table_id = table_id;
+    bp_table_reset(table_id);
+    g->gid = spec->gid;
+    g->seed = spec->seed;
+    g->winner = -1;
+    g->end_reason = END_NONE;
+    g->nplayers = spec->nplayers;
+    policy_t pol = (policy_t)spec->policy;
+    g->steps = 0;
+    g->pass_streak = 0;
+    g->policy = pol;
+    g->init_policy = (uint8_t)pol;
+    g->auto_policy = spec->auto_policy;
+    g->rr_quantum_ms = pol == RR ? CFG.quantum_ms : CFG.idle_quantum_ms;
+    g->turn_cooldown_ms = CFG.turn_cooldown_ms;
+    g->action_done = 1; // ningún turno abierto hasta que el planificador lo programe
+    g->turn_seq = 0;
+    g->cpu = -1;
+    pthread_mutex_init(&g->mtx, NULL);
+    pthread_cond_init(&g->cv, NULL);
+}
+
+// acierto de caché: la mesa termina con el resultado guardado, sin jugarse
+static void *table_finish_cached(game_state_t *g, const oc_entry_t *hit)
+{
+    MTX_LOCK(&g->mtx, "mesa");
+    g->winner = hit->winner;
+    g->end_reason = (end_reason_t)hit->end_reason;
+    g->steps = hit->steps;
+    g->finished = 1;
+    snapshot_publish(g);
+    MTX_UNLOCK(&g->mtx);
+    TLOG("=== Mesa %d: resultado en caché (%d pasos, ganador J%d) ===\n", g->table_id, g->steps, g->winner);
+    g->end_ns = now_ns();
+    if (g->winner >= 0)
+        atomic_fetch_add(&PIMC.wins_by_seat[g->winner], 1);
+    table_result_t r;
+    fill_result(g, &r);
+    for (int p = 0; p < g->nplayers; p++)
+        r.points[p] = hit->points[p];
+    r.cached = 1;
+    fq_push(g->table_id, &r);
+    return NULL;
+}
+
+void *table_thread(void *arg)
+{
+    game_state_t *g = (game_state_t *)arg;
+
+    g->start_ns = now_ns();
+    if (!g->dealt)
+    {
+        deal_t d;
+        deal_compute(g->seed, g->nplayers, &d);
+        deal_apply(g, &d);
+    }
+    int opener = g->opener;
+    tile_t first = g->opening;
+
+    int cacheable = oc_cacheable(g);
+    oc_key_t key;
+    oc_entry_t hit;
+    if (!cacheable && OC.e)
+        atomic_fetch_add(&OC.skipped, 1);
+    if (cacheable)
+    {
+        key = oc_key(g, opener);
+        if (oc_lookup(&key, &hit))
+            return table_finish_cached(g, &hit);
+    }
+
+    MTX_LOCK(&g->mtx, "mesa");
+    if (!CFG.quiet)
+    {
+        printf("\n=== Mesa %d: %d jugadores — Política: %s ===\n", g->table_id, g->nplayers,
+               policy_name(g->policy));
+        printf("Apertura: Jugador %d juega ", opener);
+        print_tile(first);
+        printf("  -> extremos: %d y %d\n", g->left_end, g->right_end);
+        for (int p = 0; p < g->nplayers; p++)
+        {
+            printf("Mano J%d (%2d fichas): ", p, g->hand_len[p]);
+            for (tmask_t m = g->hands[p]; m; m &= m - 1)
+            {
+                print_tile((tile_t)tmask_ctz(m));
+                printf(" ");
+            }
+            printf("\n");
+        }
+        printf("Pozo: %d fichas\n", g->pool_len);
+    }
+    snapshot_publish(g);
+    MTX_UNLOCK(&g->mtx);
+
+    // la propia mesa hace de planificador hasta el final; los jugadores
+    // reciben su hilo al abrirse su primer turno
+    scheduler_thread(g);
+    pthread_cond_broadcast(&g->cv);
+
+    for (int p = 0; p < g->nplayers; p++)
+        if (g->spawned & (1u << p))
+            pthread_join(g->th_players[p], NULL);
+    timer_cancel_sync(&g->t_ready);
+    timer_cancel_sync(&g->t_quantum);
+    TLOG("=== Mesa %d: terminó ===\n", g->table_id);
+    g->end_ns = now_ns();
+    if (cacheable && !g->perturbed)
+        oc_store(&key, g);
+    if (g->winner >= 0)
+        atomic_fetch_add(&PIMC.wins_by_seat[g->winner], 1);
+    table_result_t r;
+    fill_result(g, &r);
+    fq_push(g->table_id, &r);
+    return NULL;
+}
+
+/* ===== topología / afinidad / NUMA =====
+ * La topología se lee de /sys/devices/system/node/node<N>/cpulist y se cruza
+ * con las CPUs permitidas al proceso. Sin sysfs se asume un único nodo.
+ * Con --pin: el validador ocupa la primera CPU del primer nodo; las mesas se
+ * reparten por bloques contiguos entre nodos (proporcional a sus CPUs) y en
+ * round-robin dentro de cada nodo. Los hilos de sus jugadores heredan la
+ * afinidad del hilo de mesa, que hace también de planificador. El arreglo de mesas se reserva con
+ * mmap sin tocar y, en máquinas multi-nodo, cada bloque se enlaza (mbind,
+ * MPOL_PREFERRED) al nodo que lo ejecuta antes de inicializarlo.
+ */
+#define MAX_NODES 64
+#define MPOL_PREFERRED_MODE 1
+
+typedef struct
+{
+    int n_cpus, n_nodes;
+    int node_id[MAX_NODES];        // id real del nodo (pueden no ser contiguos)
+    int node_first[MAX_NODES + 1]; // desplazamientos en cpu_list por nodo
+    int cpu_list[CPU_SETSIZE];     // CPUs ordenadas por nodo
+} topology_t;
+
+static topology_t TOPO;
+
+static int parse_cpulist(const char *s, const cpu_set_t *allowed, int *out, int max)
+{
+    int n = 0;
+    while (*s && *s != '\n')
+    {
+        char *end;
+        long a = strtol(s, &end, 10), b = a;
+        if (end == s)
+            break;
+        s = end;
+        if (*s == '-')
+        {
+            b = strtol(s + 1, &end, 10);
+            s = end;
+        }
+        for (long c = a; c <= b && n < max; c++)
+            if (c < CPU_SETSIZE && CPU_ISSET((int)c, allowed))
+                out[n++] = (int)c;
+        if (*s == ',')
+            s++;
+    }
+    return n;
+}
+
+static void topology_detect(topology_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            CPU_SET(c, &allowed);
+
+    for (int node = 0; node < MAX_NODES && t->n_nodes < MAX_NODES; node++)
+    {
+        char path[96], line[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (!f)
+            continue;
+        int got = fgets(line, sizeof(line), f) != NULL;
+        fclose(f);
+        if (!got)
+            continue;
+        int n = parse_cpulist(line, &allowed, t->cpu_list + t->n_cpus, CPU_SETSIZE - t->n_cpus);
+        if (n == 0)
+            continue;
+        t->node_id[t->n_nodes] = node;
+        t->node_first[t->n_nodes] = t->n_cpus;
+        t->n_cpus += n;
+        t->n_nodes++;
+    }
+    if (t->n_nodes == 0)
+    {
+        // sin sysfs NUMA: un solo nodo con todas las CPUs permitidas
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &allowed))
+                t->cpu_list[t->n_cpus++] = c;
+        t->n_nodes = 1;
+        t->node_id[0] = 0;
+    }
+    t->node_first[t->n_nodes] = t->n_cpus;
+}
+
+static void print_cpu_ranges(const int *cpus, int n)
+{
+    for (int i = 0; i < n;)
+    {
+        int j = i;
+        while (j + 1 < n && cpus[j + 1] == cpus[j] + 1)
+            j++;
+        printf(i ? ",%d" : "%d", cpus[i]);
+        if (j > i)
+            printf("-%d", cpus[j]);
+        i = j + 1;
+    }
+}
+
+static void topology_print(const topology_t *t)
+{
+    printf("[Topología] %d nodo(s), %d CPU(s) disponibles\n", t->n_nodes, t->n_cpus);
+    for (int k = 0; k < t->n_nodes; k++)
+    {
+        printf("  nodo %d: cpus ", t->node_id[k]);
+        print_cpu_ranges(t->cpu_list + t->node_first[k], t->node_first[k + 1] - t->node_first[k]);
+        printf("\n");
+    }
+}
+
+static int pin_attr_to_cpu(pthread_attr_t *attr, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+}
+
+// arreglo de mesas sin tocar: las páginas se materializan al inicializarlas
+static game_state_t *alloc_tables(int n)
+{
+    size_t len = sizeof(game_state_t) * (size_t)n;
+    void *p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : (game_state_t *)p;
+}
+
+static void free_tables(game_state_t *tables, int n)
+{
+    munmap(tables, sizeof(game_state_t) * (size_t)n);
+}
+
+static void bind_range_to_node(void *addr, size_t len, int node)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t a = ((uintptr_t)addr + page - 1) & ~(uintptr_t)(page - 1);
+    uintptr_t b = ((uintptr_t)addr + len) & ~(uintptr_t)(page - 1);
+    if (b <= a || node >= MAX_NODES)
+        return;
+    unsigned long mask[(MAX_NODES + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))] = {0};
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, (void *)a, b - a, MPOL_PREFERRED_MODE, mask, MAX_NODES + 1, 0) != 0)
+        perror("mbind");
+}
+
+// bloque contiguo de mesas del nodo k (proporcional a sus CPUs)
+static int node_block_start(const topology_t *t, int n_tables, int k)
+{
+    if (k >= t->n_nodes)
+        return n_tables;
+    return (int)((long long)n_tables * t->node_first[k] / t->n_cpus);
+}
+
+// CPUs del nodo k utilizables por mesas: la del validador queda libre si hay más
+static void node_table_cpus(const topology_t *t, int k, int *nf, int *nl)
+{
+    *nf = t->node_first[k];
+    *nl = t->node_first[k + 1];
+    if (k == 0 && *nl - *nf > 1)
+        (*nf)++;
+}
+
+static int placement_cpu(const topology_t *t, int n_tables, int i)
+{
+    for (int k = 0; k < t->n_nodes; k++)
+    {
+        int first = node_block_start(t, n_tables, k), last = node_block_start(t, n_tables, k + 1);
+        if (i >= first && i < last)
+        {
+            int nf, nl;
+            node_table_cpus(t, k, &nf, &nl);
+            return t->cpu_list[nf + (i - first) % (nl - nf)];
+        }
+    }
+    return -1;
+}
+
+// enlaza la memoria de cada bloque a su nodo e imprime el mapa; devuelve la CPU del validador
+static int plan_placement(const topology_t *t, game_state_t *tables, int n_tables)
+{
+    for (int k = 0; k < t->n_nodes; k++)
+    {
+        int first = node_block_start(t, n_tables, k), last = node_block_start(t, n_tables, k + 1);
+        if (last <= first)
+            continue;
+        if (t->n_nodes > 1)
+            bind_range_to_node(&tables[first], sizeof(game_state_t) * (size_t)(last - first), t->node_id[k]);
+        int nf, nl;
+        node_table_cpus(t, k, &nf, &nl);
+        printf("[Afinidad] mesas %d-%d -> nodo %d (cpus ", first, last - 1, t->node_id[k]);
+        print_cpu_ranges(t->cpu_list + nf, nl - nf);
+        printf(")%s\n", t->n_nodes > 1 ? ", memoria preferente en el nodo" : "");
+    }
+    printf("[Afinidad] validador -> cpu %d (nodo %d)\n", t->cpu_list[0], t->node_id[0]);
+    return t->cpu_list[0];
+}
+
+/* ===== main ===== */
+typedef struct
+{
+    game_state_t *tables;
+    int n_tables;
+} validator_args_2; // alias para claridad
+
+void *validator_thread(void *); // fwd
+
+/* ===== opciones de línea de comandos ===== */
+static void usage(const char *prog)
+{
+    printf("Uso: %s [opciones]\n", prog);
+    puts("  --tables=N              número de mesas (si falta, se pregunta por consola)");
+    puts("  --bp-target-ms=N        activa la contrapresión con objetivo de latencia de servicio N ms");
+    puts("  --bp-max-cooldown-ms=N  tope del enfriamiento adaptativo (por defecto 200)");
+    puts("  --bp-tick-ms=N          periodo del controlador de contrapresión (por defecto 10)");
+    puts("  --stats-ms=N            imprime estadísticas cada N ms (además del resumen final)");
+    puts("  --monitor-ms=N          resumen agregado de todas las mesas cada N ms (sin bloquear mesas)");
+    puts("  --events=/nombre        publica acciones y resultados en un anillo de memoria compartida");
+    puts("  --events-cap=N          registros del anillo (potencia de 2, por defecto 65536)");
+    puts("  --tail-events=/nombre   modo lector: sigue el flujo y muestra estadísticas móviles");
+    puts("  --pin                   fija validador y mesas a CPUs y coloca cada mesa en su nodo NUMA");
+    puts("  --policy=POLÍTICA       política inicial: FCFS | SJF_PLAYERS | SJF_POINTS | RR (por defecto SJF_POINTS)");
+    puts("  --no-auto               el supervisor no cambia políticas (solo cooldown/quantum)");
+    puts("  --seed=N                semilla de reparto, llegadas y think time (por defecto, el reloj)");
+    puts("  --quiet                 silencia el registro de partida");
+    puts("  --load=all|const|poisson|burst  proceso de llegada de mesas (por defecto all: todas juntas)");
+    puts("  --rate=N                mesas/s ofrecidas por el generador (por defecto 50)");
+    puts("  --burst=N               mesas por ráfaga con --load=burst (por defecto 10)");
+    puts("  --think=none|const|exp|uniform  distribución del tiempo de pensar de los jugadores");
+    puts("  --think-ms=N            media del tiempo de pensar");
+    puts("  --saturate              busca la rodilla de saturación por política (implica --quiet)");
+    puts("  --trial-ms=N            ventana de llegadas de cada prueba de saturación (por defecto 2000)");
+    puts("  --experiment            juega cada reparto con todas las políticas y AUTO; diferencias pareadas");
+    puts("  --experiment-csv=RUTA   resultados del experimento por reparto y brazo en CSV");
+    puts("  --workers=N             reparte las mesas entre N procesos trabajadores con un coordinador");
+    puts("  --worker-inflight=N     mesas activas como máximo por trabajador (por defecto 64)");
+    puts("  --worker-batch=N        mesas por lote de asignación y resultados por mensaje (por defecto 16)");
+    puts("  --trace-out=FICHERO     vuelca intervalos en formato Chrome trace (compilar con -DDOMINO_TRACE)");
+    puts("  --lock-stats            mide espera y retención por lock y sitio; informe ordenado al salir");
+    puts("  --strategy=first|pimc   estrategia de los jugadores (por defecto first: primera ficha jugable)");
+    puts("  --pimc-seats=LISTA      asientos que usan PIMC, p. ej. 0,2 (por defecto todos)");
+    puts("  --pimc-budget-us=N      plazo de decisión PIMC por turno (por defecto 2000)");
+    puts("  --pimc-threads=N        hilos del pool de partidas simuladas (por defecto CPUs - 1)");
+    puts("  --tile-set=6|9|12       juego de fichas: doble-6 (por defecto), doble-9 o doble-12");
+    puts("  --players=N             máximo de jugadores por mesa, 2..N según la semilla (por defecto 4)");
+    puts("  --speculate             decide la próxima acción mientras espera el turno");
+    puts("  --outcome-cache=N       reutiliza resultados de repartos ya jugados (N entradas, LRU)");
+    puts("  --outcome-cache-file=RUTA  carga la caché al empezar y la guarda al terminar");
+    puts("  --cooldown-ms=N         enfriamiento base de cada turno (por defecto 0)");
+    puts("  --blocked-cooldown-ms=N enfriamiento extra en racha de pases (por defecto 75)");
+    puts("  --quantum-ms=N          quantum de las mesas en RR (por defecto 120)");
+    puts("  --idle-quantum-ms=N     quantum de las mesas en otras políticas (por defecto 200)");
+    puts("  --queue-cap=N           capacidad inicial de la cola global (por defecto 1024)");
+    puts("  --supervisor-ms=N       periodo del supervisor automático (por defecto 100)");
+    puts("  --policy-poll-ms=N      espera del aplicador de cambios con la cola vacía (por defecto 50)");
+    puts("  --config=RUTA           lee opciones de un fichero, una por línea (sin '--'); la línea de comandos manda");
+    puts("  --autotune              busca la configuración más rápida de los parámetros anteriores");
+    puts("  --autotune-reps=N       repeticiones por configuración; cuenta la mediana (por defecto 3)");
+    puts("  --autotune-out=RUTA     fichero de configuración resultante (por defecto domino.conf)");
+    puts("  --results=RUTA          añade una fila por mesa terminada al almacén columnar RUTA");
+    puts("  --query=RUTA            modo consulta: agrega el almacén y sale");
+    puts("  --query-by=policy|final-policy|players|switches|end  agrupación de --query (por defecto policy)");
+    puts("  --predeal=N             repartos preparados por delante del lanzamiento (por defecto 256; 0 => cada mesa reparte)");
+    puts("  --launchers=N           hilos que lanzan las mesas en paralelo con --load=all (por defecto según CPUs)");
+    puts("  --max-running=N         mesas en marcha a la vez; el resto espera inicializado (por defecto sin tope)");
+    puts("  --help                  muestra esta ayuda");
+}
+
+// acepta "--nombre" como interruptor; devuelve 1 si la reconoció
+static int opt_flag(const char *arg, const char *name, int *out)
+{
+    if (strcmp(arg, name) != 0)
+        return 0;
+    *out = 1;
+    return 1;
+}
+
+// acepta "--nombre=texto"; devuelve 1 si la reconoció
+static int opt_str(const char *arg, const char *name, const char **out)
+{
+    size_t n = strlen(name);
+    if (strncmp(arg, name, n) != 0 || arg[n] != '=' || arg[n + 1] == '\0')
+        return 0;
+    *out = arg + n + 1;
+    return 1;
+}
+
+// acepta "--nombre=valor" para opciones enteras; devuelve 1 si la reconoció
+static int opt_int(const char *arg, const char *name, int *out)
+{
+    size_t n = strlen(name);
+    if (strncmp(arg, name, n) != 0 || arg[n] != '=')
+        return 0;
+    char *end = NULL;
+    long v = strtol(arg + n + 1, &end, 10);
+    if (end == arg + n + 1 || *end != '\0' || v < 0 || v > INT_MAX)
+    {
+        fprintf(stderr, "Valor inválido para %s\n", name);
+        exit(1);
+    }
+    *out = (int)v;
+    return 1;
+}
+
+// acepta "--nombre=valor" con valor dentro de names[]; devuelve 1 si la reconoció
+static int opt_enum(const char *arg, const char *name, const char *const *names, int n_names, int *out)
+{
+    const char *v = NULL;
+    if (!opt_str(arg, name, &v))
+        return 0;
+    for (int k = 0; k < n_names; k++)
+        if (strcasecmp(v, names[k]) == 0)
+        {
+            *out = k;
+            return 1;
+        }
+    fprintf(stderr, "Valor inválido para %s: %s\n", name, v);
+    exit(1);
+}
+
+// --config: una opción por línea, sin el "--" inicial; '#' comenta hasta el final
+// de línea. Devuelve cuántas opciones añadió a *out (en memoria propia).
+static int read_config_file(const char *path, char ***out)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        exit(1);
+    }
+    char line[512];
+    int n = 0, cap = 0;
+    char **opts = NULL;
+    while (fgets(line, sizeof(line), f))
+    {
+        char *c = strchr(line, '#');
+        if (c)
+            *c = '\0';
+        char *b = line, *e = line + strlen(line);
+        while (*b == ' ' || *b == '\t')
+            b++;
+        while (e > b && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n' || e[-1] == '\r'))
+            *--e = '\0';
+        if (!*b)
+            continue;
+        if (n == cap)
+        {
+            cap = cap ? cap * 2 : 16;
+            char **grown = realloc(opts, sizeof(char *) * cap);
+            if (!grown)
+            {
+                perror("config");
+                exit(1);
+            }
+            opts = grown;
+        }
+        opts[n] = malloc(strlen(b) + 3);
+        if (!opts[n])
+        {
+            perror("config");
+            exit(1);
+        }
+        sprintf(opts[n++], "--%s", b);
+    }
+    fclose(f);
+    *out = opts;
+    return n;
+}
+
+static void parse_args(int argc, char **argv)
+{
+    static const char *const load_names[] = {"all", "const", "poisson", "burst"};
+    static const char *const think_names[] = {"none", "const", "exp", "uniform"};
+    static const char *const strategy_names[] = {"first", "pimc"};
+    static const char *const query_by_names[] = {"policy", "final-policy", "players", "switches", "end"};
+    int load = CFG.load, think = CFG.think, seed = 0, no_auto = 0, strategy = CFG.strategy;
+    const char *policy = NULL, *seats = NULL, *config = NULL;
+
+    // las opciones del fichero van delante: la línea de comandos las sobrescribe
+    char **file_opts = NULL;
+    int n_file = 0;
+    for (int i = 1; i < argc; i++)
+        if (opt_str(argv[i], "--config", &config))
+            n_file = read_config_file(config, &file_opts);
+    int n_args = n_file + argc - 1;
+
+    for (int i = 0; i < n_args; i++)
+    {
+        const char *a = i < n_file ? file_opts[i] : argv[i - n_file + 1];
+        if (strcmp(a, "--help") == 0)
+        {
+            usage(argv[0]);
+            exit(0);
+        }
+        if (opt_int(a, "--tables", &CFG.n_tables) ||
+            opt_int(a, "--bp-target-ms", &CFG.bp_target_ms) ||
+            opt_int(a, "--bp-max-cooldown-ms", &CFG.bp_max_cooldown_ms) ||
+            opt_int(a, "--bp-tick-ms", &CFG.bp_tick_ms) ||
+            opt_int(a, "--stats-ms", &CFG.stats_ms) ||
+            opt_int(a, "--monitor-ms", &CFG.monitor_ms) ||
+            opt_str(a, "--events", &CFG.events_shm) ||
+            opt_int(a, "--events-cap", &CFG.events_cap) ||
+            opt_str(a, "--tail-events", &CFG.tail_events) ||
+            opt_flag(a, "--pin", &CFG.pin) ||
+            opt_str(a, "--policy", &policy) ||
+            opt_flag(a, "--no-auto", &no_auto) ||
+            opt_int(a, "--seed", &seed) ||
+            opt_flag(a, "--quiet", &CFG.quiet) ||
+            opt_enum(a, "--load", load_names, 4, &load) ||
+            opt_int(a, "--rate", &CFG.rate) ||
+            opt_int(a, "--burst", &CFG.burst) ||
+            opt_enum(a, "--think", think_names, 4, &think) ||
+            opt_int(a, "--think-ms", &CFG.think_ms) ||
+            opt_flag(a, "--saturate", &CFG.saturate) ||
+            opt_int(a, "--trial-ms", &CFG.trial_ms) ||
+            opt_flag(a, "--experiment", &CFG.experiment) ||
+            opt_str(a, "--experiment-csv", &CFG.experiment_csv) ||
+            opt_int(a, "--workers", &CFG.workers) ||
+            opt_int(a, "--worker-inflight", &CFG.worker_inflight) ||
+            opt_int(a, "--worker-batch", &CFG.worker_batch) ||
+            opt_str(a, "--trace-out", &CFG.trace_out) ||
+            opt_flag(a, "--lock-stats", &CFG.lock_stats) ||
+            opt_enum(a, "--strategy", strategy_names, 2, &strategy) ||
+            opt_str(a, "--pimc-seats", &seats) ||
+            opt_int(a, "--pimc-budget-us", &CFG.pimc_budget_us) ||
+            opt_int(a, "--pimc-threads", &CFG.pimc_threads) ||
+            opt_flag(a, "--speculate", &CFG.speculate) ||
+            opt_int(a, "--tile-set", &CFG.pips) ||
+            opt_int(a, "--players", &CFG.max_players) ||
+            opt_int(a, "--outcome-cache", &CFG.outcome_cache) ||
+            opt_str(a, "--outcome-cache-file", &CFG.outcome_cache_file) ||
+            opt_int(a, "--cooldown-ms", &CFG.turn_cooldown_ms) ||
+            opt_int(a, "--blocked-cooldown-ms", &CFG.blocked_cooldown_ms) ||
+            opt_int(a, "--quantum-ms", &CFG.quantum_ms) ||
+            opt_int(a, "--idle-quantum-ms", &CFG.idle_quantum_ms) ||
+            opt_int(a, "--queue-cap", &CFG.queue_cap) ||
+            opt_int(a, "--supervisor-ms", &CFG.supervisor_ms) ||
+            opt_int(a, "--policy-poll-ms", &CFG.policy_poll_ms) ||
+            opt_str(a, "--config", &config) ||
+            opt_flag(a, "--autotune", &CFG.autotune) ||
+            opt_int(a, "--autotune-reps", &CFG.autotune_reps) ||
+            opt_str(a, "--autotune-out", &CFG.autotune_out) ||
+            opt_str(a, "--results", &CFG.results) ||
+            opt_str(a, "--query", &CFG.query) ||
+            opt_enum(a, "--query-by", query_by_names, 5, &CFG.query_by) ||
+            opt_int(a, "--predeal", &CFG.predeal) ||
+            opt_int(a, "--launchers", &CFG.launchers) ||
+            opt_int(a, "--max-running", &CFG.max_running))
+            continue;
+        fprintf(stderr, "Opción desconocida: %s\n", a);
+        usage(argv[0]);
+        exit(1);
+    }
+    if (CFG.bp_tick_ms <= 0)
+        CFG.bp_tick_ms = 1;
+    if (policy && !parse_policy(policy, &CFG.default_policy))
+    {
+        fprintf(stderr, "Política desconocida: %s\n", policy);
+        exit(1);
+    }
+    CFG.load = (load_kind_t)load;
+    CFG.think = (think_kind_t)think;
+    CFG.strategy = (strategy_t)strategy;
+    if (seats)
+    {
+        // lista de asientos separados por comas, p. ej. "0,2"
+        CFG.pimc_seats = 0;
+        for (const char *c = seats; *c; c++)
+        {
+            if (*c >= '0' && *c < '0' + MAX_PLAYERS)
+                CFG.pimc_seats |= 1u << (*c - '0');
+            else if (*c != ',')
+            {
+                fprintf(stderr, "Valor inválido para --pimc-seats: %s\n", seats);
+                exit(1);
+            }
+        }
+    }
+    CFG.seed = (unsigned)seed;
+    CFG.auto_policy = !no_auto;
+    if (CFG.burst <= 0)
+        CFG.burst = 1;
+    if (CFG.worker_inflight <= 0)
+        CFG.worker_inflight = 1;
+    if (CFG.worker_batch <= 0)
+        CFG.worker_batch = 1;
+    if (CFG.think != THINK_NONE && CFG.think_ms <= 0)
+        CFG.think = THINK_NONE;
+    if ((CFG.pips != 6 && CFG.pips != 9 && CFG.pips != 12) || CFG.pips > MAX_PIP)
+    {
+        fprintf(stderr, "--tile-set=%d no disponible (6, 9 o 12; este binario admite hasta doble-%d)\n", CFG.pips,
+                MAX_PIP);
+        exit(1);
+    }
+    if (CFG.max_players < 2 || CFG.max_players > MAX_PLAYERS || CFG.max_players * HAND_DEAL > SET_TILES(CFG.pips))
+    {
+        fprintf(stderr, "--players=%d no válido con doble-%d (2..%d)\n", CFG.max_players, CFG.pips,
+                SET_TILES(CFG.pips) / HAND_DEAL < MAX_PLAYERS ? SET_TILES(CFG.pips) / HAND_DEAL : MAX_PLAYERS);
+        exit(1);
+    }
+    if (CFG.outcome_cache_file && CFG.outcome_cache <= 0)
+        CFG.outcome_cache = 65536;
+    if (CFG.queue_cap <= 0)
+        CFG.queue_cap = 1;
+    if (CFG.supervisor_ms <= 0)
+        CFG.supervisor_ms = 1;
+    if (CFG.policy_poll_ms <= 0)
+        CFG.policy_poll_ms = 1;
+    if (CFG.autotune_reps <= 0)
+        CFG.autotune_reps = 1;
+}
+
+/* ===== ejecución de una simulación ===== */
+typedef struct
+{
+    int n_tables;
+    double secs;          // pared, desde el arranque hasta que termina la última mesa
+    double arrival_secs;  // ventana de llegadas
+    double arrival_lag_ms; // retraso máximo de una llegada respecto a su instante teórico
+    long actions;
+    double turn_p50_ms, turn_p99_ms, turn_mean_ms;
+    double first_move_ms;  // desde el arranque hasta la primera acción aplicada (-1 => ninguna)
+    double all_running_ms; // desde el arranque hasta que arrancó la última mesa
+    long forced;           // turnos forzados por quantum agotado
+} run_report_t;
+
+/* ----- fuentes de mesas -----
+ * run_simulation pide las mesas a una fuente: la local sigue el proceso de
+ * llegadas configurado; la del modo distribuido las recibe del coordinador.
+ */
+typedef struct table_source_s
+{
+    // bloquea hasta la siguiente mesa; 1 => *out válido, 0 => no hay más
+    int (*next)(struct table_source_s *src, table_spec_t *out);
+    // opcional, sin bloquear ni consumir: la mesa idx-ésima que entregará next
+    // (0 => no hay o no se sabe); la llama el repartidor desde otro hilo
+    int (*peek)(struct table_source_s *src, int idx, table_spec_t *out);
+    void *ctx;
+} table_source_t;
+
+typedef struct
+{
+    int n, i;
+    rng_t rng;
+    long long due, max_lag;
+} arrival_source_t;
+
+static uint32_t table_seed(unsigned run_seed, int gid)
+{
+    rng_t r = {.s = ((uint64_t)run_seed << 32) ^ (uint64_t)(uint32_t)gid};
+    return (uint32_t)rng_next(&r);
+}
+
+// de 2 a --players jugadores según la semilla de la mesa
+static uint8_t table_players(uint32_t seed) { return (uint8_t)(2 + seed % (uint32_t)(CFG.max_players - 1)); }
+
+// separación hasta la siguiente llegada según el proceso configurado
+static long long next_arrival_gap_ns(rng_t *rng, int i)
+{
+    double mean_s = 1.0 / (CFG.rate > 0 ? CFG.rate : 1);
+    switch (CFG.load)
+    {
+    case LOAD_ALL_AT_ONCE:
+        return 0;
+    case LOAD_CONST:
+        return (long long)(mean_s * 1e9);
+    case LOAD_POISSON:
+        return (long long)(rng_exp(rng, mean_s) * 1e9);
+    case LOAD_BURST:
+        // 'burst' mesas juntas; entre ráfagas, burst/rate segundos
+        return (i % CFG.burst == 0) ? (long long)(mean_s * CFG.burst * 1e9) : 0;
+    }
+    return 0;
+}
+
+static void arrival_spec(int i, table_spec_t *out)
+{
+    out->gid = i;
+    out->seed = table_seed(CFG.seed, i);
+    out->nplayers = table_players(out->seed);
+    out->policy = (uint8_t)CFG.default_policy;
+    out->auto_policy = (uint8_t)CFG.auto_policy;
+}
+
+static int arrival_peek(table_source_t *src, int idx, table_spec_t *out)
+{
+    arrival_source_t *a = (arrival_source_t *)src->ctx;
+    if (idx >= a->n)
+        return 0;
+    arrival_spec(idx, out);
+    return 1;
+}
+
+static int arrival_next(table_source_t *src, table_spec_t *out)
+{
+    arrival_source_t *a = (arrival_source_t *)src->ctx;
+    if (a->i >= a->n)
+        return 0;
+    if (a->i == 0)
+        a->due = now_ns();
+    else
+        a->due += next_arrival_gap_ns(&a->rng, a->i);
+    long long now = now_ns();
+    if (a->due > now)
+        sleep_ns(a->due - now);
+    else if (now - a->due > a->max_lag)
+        a->max_lag = now - a->due;
+
+    arrival_spec(a->i, out);
+    a->i++;
+    return 1;
+}
+
+/* ===== reparto anticipado =====
+ * Un hilo repartidor va por delante del lanzamiento: pide a la fuente las
+ * mesas que vienen (peek), baraja, resuelve la apertura y deja cada reparto
+ * en un anillo SPSC sin locks. El lanzador copia el reparto en la mesa antes
+ * de crear su hilo, así que la mesa empieza a jugar sin barajar. Si el
+ * repartidor va por detrás, la mesa reparte ella misma y el repartidor salta
+ * a la siguiente posición pendiente. Las fuentes sin peek (modo distribuido)
+ * reparten siempre en la mesa. Solo con el anillo lleno el repartidor aparca
+ * en un mutex/condición, y el lanzador lo despierta al consumir.
+ */
+typedef struct
+{
+    deal_t *ring;
+    unsigned cap;           // potencia de 2
+    atomic_uint head, tail; // head: lanzador (consumidor), tail: repartidor (productor)
+    atomic_int want;        // siguiente posición que pedirá el lanzador
+    atomic_int stop, parked;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    table_source_t *src;
+    pthread_t th;
+    int on;
+    long served, missed; // repartos tomados del anillo / hechos en la mesa (solo el lanzador)
+} dealer_t;
+
+static dealer_t DEALER;
+
+static void *dealer_thread(void *arg)
+{
+    (void)arg;
+    int idx = 0;
+    const deal_t *last = NULL;
+    table_spec_t spec;
+    while (!atomic_load(&DEALER.stop))
+    {
+        unsigned t = atomic_load_explicit(&DEALER.tail, memory_order_relaxed);
+        if (t - atomic_load(&DEALER.head) == DEALER.cap)
+        {
+            // parked antes de releer head: el lanzador o ve parked o ya movió head
+            atomic_store(&DEALER.parked, 1);
+            MTX_LOCK(&DEALER.mtx, "reparto");
+            while (!atomic_load(&DEALER.stop) && t - atomic_load(&DEALER.head) == DEALER.cap)
+                CV_WAIT(&DEALER.cv, &DEALER.mtx);
+            MTX_UNLOCK(&DEALER.mtx);
+            atomic_store(&DEALER.parked, 0);
+            continue;
+        }
+        int want = atomic_load_explicit(&DEALER.want, memory_order_relaxed);
+        if (idx < want)
+        {
+            idx = want; // el lanzador ya pasó de aquí
+            last = NULL;
+        }
+        if (!DEALER.src->peek(DEALER.src, idx, &spec))
+            break;
+        deal_t *d = &DEALER.ring[t & (DEALER.cap - 1)];
+        if (last && last->seed == spec.seed && last->nplayers == spec.nplayers)
+            *d = *last; // mismo reparto seguido (los brazos del experimento)
+        else
+            deal_compute(spec.seed, spec.nplayers, d);
+        d->idx = idx++;
+        atomic_store_explicit(&DEALER.tail, t + 1, memory_order_release);
+        last = d; // solo el repartidor reescribe ranuras: sigue intacta
+    }
+    return NULL;
+}
+
+static void dealer_start(table_source_t *src)
+{
+    DEALER.on = 0;
+    DEALER.served = DEALER.missed = 0;
+    if (CFG.predeal <= 0 || !src->peek)
+        return;
+    unsigned cap = 1;
+    while (cap < (unsigned)CFG.predeal)
+        cap <<= 1;
+    DEALER.ring = malloc(sizeof(deal_t) * cap);
+    if (!DEALER.ring)
+        return; // sin anillo, cada mesa reparte
+    DEALER.cap = cap;
+    DEALER.src = src;
+    atomic_store(&DEALER.head, 0);
+    atomic_store(&DEALER.tail, 0);
+    atomic_store(&DEALER.want, 0);
+    atomic_store(&DEALER.stop, 0);
+    atomic_store(&DEALER.parked, 0);
+    pthread_mutex_init(&DEALER.mtx, NULL);
+    pthread_cond_init(&DEALER.cv, NULL);
+    if (pthread_create(&DEALER.th, NULL, dealer_thread, NULL) != 0)
+    {
+        perror("pthread_create(dealer)");
+        free(DEALER.ring);
+        return;
+    }
+    DEALER.on = 1;
+}
+
+// aplica el reparto anticipado de la mesa idx-ésima; 0 => no estaba listo
+static int dealer_take(int idx, const table_spec_t *spec, game_state_t *g)
+{
+    if (!DEALER.on)
+        return 0;
+    int got = 0;
+    unsigned h = atomic_load_explicit(&DEALER.head, memory_order_relaxed);
+    while (h != atomic_load_explicit(&DEALER.tail, memory_order_acquire))
+    {
+        const deal_t *d = &DEALER.ring[h & (DEALER.cap - 1)];
+        if (d->idx > idx)
+            break;
+        h++; // las posiciones anteriores ya se repartieron en su mesa
+        if (d->idx == idx && d->seed == spec->seed && d->nplayers == spec->nplayers)
+        {
+            deal_apply(g, d);
+            got = 1;
+            break;
+        }
+    }
+    atomic_store(&DEALER.want, idx + 1);
+    atomic_store(&DEALER.head, h);
+    if (atomic_load(&DEALER.parked))
+    {
+        MTX_LOCK(&DEALER.mtx, "reparto");
+        pthread_cond_broadcast(&DEALER.cv);
+        MTX_UNLOCK(&DEALER.mtx);
+    }
+    if (got)
+        DEALER.served++;
+    else
+        DEALER.missed++;
+    return got;
+}
+
+static void dealer_print_stats(void)
+{
+    if (DEALER.served + DEALER.missed == 0)
+        return;
+    printf("[Stats] reparto anticipado: servidos=%ld (%.1f%%) en la mesa=%ld\n", DEALER.served,
+           100.0 * DEALER.served / (DEALER.served + DEALER.missed), DEALER.missed);
+}
+
+static void dealer_stop(void)
+{
+    if (!DEALER.on)
+        return;
+    atomic_store(&DEALER.stop, 1);
+    MTX_LOCK(&DEALER.mtx, "reparto");
+    pthread_cond_broadcast(&DEALER.cv);
+    MTX_UNLOCK(&DEALER.mtx);
+    pthread_join(DEALER.th, NULL);
+    pthread_mutex_destroy(&DEALER.mtx);
+    pthread_cond_destroy(&DEALER.cv);
+    free(DEALER.ring);
+    DEALER.ring = NULL;
+}
+
+/* ===== arranque en paralelo =====
+ * Con todas las mesas llegando a la vez (--load=all) y una fuente que sabe
+ * anticipar, el lanzamiento se reparte en bloques contiguos entre varios hilos
+ * lanzadores: cada uno inicializa, reparte y arranca sus mesas, así que la
+ * primera jugada no espera a que se lancen las demás. El arranque de cada
+ * mesa es barato: la propia mesa planifica y sus jugadores reciben hilo en su
+ * primer turno. Con --max-running solo ese número de mesas tiene hilos a la
+ * vez; el resto espera inicializado a que termine otra.
+ */
+typedef struct
+{
+    game_state_t *tables;
+    pthread_t *th;
+    table_source_t *src;
+    int n_tables, lo, hi;
+} launcher_args_t;
+
+// crea el hilo de una mesa ya inicializada (esperando hueco con --max-running)
+static int launch_table(game_state_t *tables, pthread_t *th, int n_tables, int i)
+{
+    // jugadores heredan la afinidad del hilo de mesa
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (CFG.pin)
+    {
+        tables[i].cpu = placement_cpu(&TOPO, n_tables, i);
+        pin_attr_to_cpu(&attr, tables[i].cpu);
+    }
+    comp_run_acquire();
+    comp_add();
+    int rc = pthread_create(&th[i], &attr, table_thread, &tables[i]);
+    pthread_attr_destroy(&attr);
+    if (rc != 0)
+    {
+        perror("pthread_create(table)");
+        return -1;
+    }
+    return 0;
+}
+
+static void *launcher_thread(void *arg)
+{
+    launcher_args_t *la = (launcher_args_t *)arg;
+    for (int i = la->lo; i < la->hi; i++)
+    {
+        table_spec_t spec;
+        la->src->peek(la->src, i, &spec);
+        init_table(&la->tables[i], i, &spec);
+        deal_t d;
+        deal_compute(spec.seed, spec.nplayers, &d);
+        deal_apply(&la->tables[i], &d);
+        if (launch_table(la->tables, la->th, la->n_tables, i) != 0)
+            exit(1);
+    }
+    return NULL;
+}
+
+// lanzadores para n mesas simultáneas; 1 => lanzamiento en serie desde la fuente
+static int launcher_count(table_source_t *src, int n)
+{
+    table_spec_t spec;
+    if (CFG.load != LOAD_ALL_AT_ONCE || !src->peek || n <= 0 || !src->peek(src, n - 1, &spec))
+        return 1;
+    long k = CFG.launchers;
+    if (k <= 0)
+    {
+        k = sysconf(_SC_NPROCESSORS_ONLN);
+        if (k > n / 64) // bloques de al menos 64 mesas
+            k = n / 64;
+    }
+    if (k > n)
+        k = n;
+    return k < 1 ? 1 : (int)k;
+}
+
+// lanza las n mesas entre k hilos; devuelve las lanzadas
+static int launch_parallel(game_state_t *tables, pthread_t *th, int n, int k, table_source_t *src)
+{
+    pthread_t *lth = malloc(sizeof(pthread_t) * k);
+    launcher_args_t *la = malloc(sizeof(launcher_args_t) * k);
+    if (!lth || !la)
+    {
+        perror("alloc");
+        exit(1);
+    }
+    for (int j = 0; j < k; j++)
+    {
+        la[j] = (launcher_args_t){.tables = tables, .th = th, .src = src, .n_tables = n,
+                                  .lo = (int)((long long)n * j / k), .hi = (int)((long long)n * (j + 1) / k)};
+        if (pthread_create(&lth[j], NULL, launcher_thread, &la[j]) != 0)
+        {
+            perror("pthread_create(launcher)");
+            exit(1);
         }
-        if (act.table_id < 0 || act.table_id >= N)
+    }
+    for (int j = 0; j < k; j++)
+        pthread_join(lth[j], NULL);
+    free(lth);
+    free(la);
+    return n;
+}
+
+// n_tables es el número de ranuras: las que la fuente no llegue a usar se dan
+// por terminadas; si da más mesas, cada una espera la ranura de otra ya recogida
+static int run_simulation(int n_tables, int interactive, table_source_t *src, run_report_t *rep)
+{
+    int capacity = n_tables;
+    game_state_t *tables = alloc_tables(n_tables);
+    pthread_t *th_tables = calloc(n_tables, sizeof(pthread_t));
+    if (!tables || !th_tables)
+    {
+        perror("alloc");
+        return 1;
+    }
+
+    int validator_cpu = CFG.pin ? plan_placement(&TOPO, tables, n_tables) : -1;
+    RUN_T0_NS = now_ns();
+    FIRST_MOVE_NS = 0;
+    memset(&TURN_HIST, 0, sizeof(TURN_HIST));
+    memset(&START_HIST, 0, sizeof(START_HIST));
+    atomic_store(&SPEC.hits, 0);
+    atomic_store(&SPEC.stale, 0);
+    atomic_store(&SPEC.none, 0);
+
+    if (fq_init(n_tables) != 0)
+    {
+        perror("alloc");
+        return 1;
+    }
+    comp_init(1); // ficha del lanzamiento
+    pthread_t th_reaper;
+    if (pthread_create(&th_reaper, NULL, reaper_thread, NULL) != 0)
+    {
+        perror("pthread_create(reaper)");
+        return 1;
+    }
+
+    // Validador único global
+    q_init(&GQ);
+    policy_q_init(&POLICY_Q);
+    bp_init(CFG.bp_target_ms, CFG.bp_max_cooldown_ms, n_tables);
+    pimc_start();
+    timers_start();
+    atomic_store(&QUANTUM_EXPIRED, 0);
+    validator_args_t va = {.tables = tables, .n_tables = n_tables};
+    pthread_t th_validator;
+    pthread_attr_t attr_validator;
+    pthread_attr_init(&attr_validator);
+    if (validator_cpu >= 0)
+        pin_attr_to_cpu(&attr_validator, validator_cpu);
+    if (pthread_create(&th_validator, &attr_validator, validator_thread, &va) != 0)
+    {
+        perror("pthread_create(validator)");
+        return 1;
+    }
+    pthread_attr_destroy(&attr_validator);
+
+    policy_supervisor_args_t psa = {.tables = tables, .n_tables = n_tables};
+    pthread_t th_policy_supervisor;
+    if (pthread_create(&th_policy_supervisor, NULL, policy_supervisor_thread, &psa) != 0)
+    {
+        perror("pthread_create(policy_supervisor)");
+        return 1;
+    }
+
+    // Hilo de control en caliente (consola)
+    control_args_t ca = {.tables = tables, .n_tables = n_tables};
+    pthread_t th_control;
+    int control_thread_started = 0;
+    if (pthread_create(&th_control, NULL, control_thread, &ca) != 0)
+    {
+        perror("pthread_create(control)"); /* no abortamos; solo avisamos */
+    }
+    else
+    {
+        control_thread_started = 1;
+    }
+
+    // Consola (show / stats / policy / quantum): queda bloqueada en stdin, no se une
+    pthread_t th_console;
+    if (interactive && pthread_create(&th_console, NULL, console_thread, &ca) == 0)
+        pthread_detach(th_console);
+
+    pthread_t th_monitor;
+    int monitor_started = CFG.monitor_ms > 0 && pthread_create(&th_monitor, NULL, monitor_thread, &ca) == 0;
+
+    // Controlador de contrapresión y estadísticas periódicas
+    pthread_t th_bp;
+    if (pthread_create(&th_bp, NULL, backpressure_thread, &ca) != 0)
+    {
+        perror("pthread_create(backpressure)");
+        return 1;
+    }
+
+    // Lanzar mesas: todas a la vez entre varios lanzadores, o según las entregue la fuente
+    int launched = 0, slots_used = 0;
+    int n_launchers = launcher_count(src, n_tables);
+    if (n_launchers > 1)
+        launched = slots_used = launch_parallel(tables, th_tables, n_tables, n_launchers, src);
+    else
+    {
+        // con todas las ranuras ocupadas se reutiliza la de una mesa ya recogida
+        dealer_start(src);
+        table_spec_t spec;
+        while (src->next(src, &spec))
+        {
+            int i = slots_used < n_tables ? slots_used++ : fq_take_slot();
+            init_table(&tables[i], i, &spec);
+            dealer_take(launched++, &spec, &tables[i]);
+            if (launch_table(tables, th_tables, n_tables, i) != 0)
+                return 1;
+        }
+        dealer_stop();
+    }
+    double arrival_secs = (now_ns() - RUN_T0_NS) / 1e9;
+    for (int i = slots_used; i < n_tables; i++)
+        tables[i].finished = 1; // ranuras sin usar
+    comp_release(1); // la fuente no da más mesas
+    n_tables = launched;
+
+    // el recolector ya unió cada mesa al consumir su entrada de la cola de finalización
+    pthread_join(th_reaper, NULL);
+    long long end_ns = now_ns(); // sin contar la parada de los hilos auxiliares
+    long long last_start_ns = RUN_T0_NS;
+    for (int i = 0; i < slots_used; i++)
+        if (tables[i].start_ns > last_start_ns)
+            last_start_ns = tables[i].start_ns;
+    double first_move_ms = FIRST_MOVE_NS ? (FIRST_MOVE_NS - RUN_T0_NS) / 1e6 : -1.0;
+    double all_running_ms = (last_start_ns - RUN_T0_NS) / 1e6;
+    pthread_join(th_validator, NULL);
+    if (control_thread_started)
+        pthread_join(th_control, NULL);
+
+    policy_q_stop(&POLICY_Q);
+    pthread_join(th_policy_supervisor, NULL);
+    pthread_join(th_bp, NULL);
+    if (monitor_started)
+        pthread_join(th_monitor, NULL);
+    bp_stop();
+    pimc_stop();
+    timers_stop();
+
+    if (rep)
+    {
+        rep->n_tables = n_tables;
+        rep->secs = (end_ns - RUN_T0_NS) / 1e9;
+        rep->arrival_secs = arrival_secs;
+        rep->arrival_lag_ms = 0.0;
+        rep->actions = BP.total_count;
+        rep->turn_p50_ms = lat_hist_pct_ms(&TURN_HIST, 0.50);
+        rep->turn_p99_ms = lat_hist_pct_ms(&TURN_HIST, 0.99);
+        rep->turn_mean_ms = TURN_HIST.count ? TURN_HIST.sum_ns / 1e6 / TURN_HIST.count : 0.0;
+        rep->first_move_ms = first_move_ms;
+        rep->all_running_ms = all_running_ms;
+        rep->forced = atomic_load(&QUANTUM_EXPIRED);
+    }
+    if (interactive)
+    {
+        print_stats();
+        printf("[Arranque] %d mesas, %d lanzador%s: lanzamiento %.1f ms, primera jugada %.1f ms, "
+               "todas en marcha %.1f ms\n",
+               n_tables, n_launchers, n_launchers == 1 ? "" : "es", arrival_secs * 1e3, first_move_ms,
+               all_running_ms);
+    }
+    q_destroy(&GQ);
+    policy_q_destroy(&POLICY_Q);
+    gcfg_reset();
+    bp_destroy();
+    comp_destroy();
+    fq_destroy();
+    free(th_tables);
+    free_tables(tables, capacity);
+    return 0;
+}
+
+/* ===== búsqueda de saturación =====
+ * Para cada política (y cada configuración del validador: base y, si se pidió
+ * --bp-target-ms, con contrapresión) se repiten pruebas de duración ~trial_ms
+ * multiplicando la tasa de llegadas por 1.5. La rodilla es la primera prueba
+ * cuyo p99 de latencia de turno supera 5x el p99 de la primera prueba (y al
+ * menos 1 ms) o en la que el generador no logra sostener las llegadas (retraso
+ * acumulado > 20% de la ventana de llegadas). Sostenible = última tasa antes
+ * de la rodilla.
+ */
+#define SAT_MAX_TRIALS 12
+#define SAT_KNEE_FACTOR 5.0
+#define SAT_RAMP 1.5
+
+typedef struct
+{
+    policy_t policy;
+    int bp;
+    double sustainable, knee_rate, knee_p99_ms;
+} sat_result_t;
+
+static void saturation_search(void)
+{
+    static const policy_t policies[] = {FCFS, SJF_PLAYERS, SJF_POINTS, RR};
+    int n_validator_cfgs = CFG.bp_target_ms > 0 ? 2 : 1;
+    int bp_target = CFG.bp_target_ms;
+    sat_result_t results[8];
+    int n_results = 0;
+
+    CFG.auto_policy = 0; // política fija durante cada barrido
+    if (CFG.load == LOAD_ALL_AT_ONCE)
+        CFG.load = LOAD_POISSON;
+    int start_rate = CFG.rate > 0 ? CFG.rate : 1;
+
+    for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++)
+        for (int v = 0; v < n_validator_cfgs; v++)
+        {
+            CFG.default_policy = policies[p];
+            CFG.bp_target_ms = v ? bp_target : 0;
+            sat_result_t r = {.policy = policies[p], .bp = v};
+            double base_p99 = -1.0, rate = start_rate;
+
+            printf("\n--- Saturación: %s, validador %s ---\n", policy_name(policies[p]), v ? "con contrapresión" : "base");
+            printf("%10s %7s %10s %10s %10s %9s\n", "mesas/s", "mesas", "turno p50", "turno p99", "acciones/s", "retraso");
+            for (int t = 0; t < SAT_MAX_TRIALS; t++)
+            {
+                CFG.rate = (int)rate;
+                int n = (int)(rate * CFG.trial_ms / 1000.0);
+                if (n < 20)
+                    n = 20;
+                run_report_t rep;
+                arrival_source_t arr = {.n = n, .rng = {.s = CFG.seed * 0x2545f4914f6cdd1dULL + (uint64_t)t}};
+                table_source_t src = {.next = arrival_next, .peek = arrival_peek, .ctx = &arr};
+                if (run_simulation(n, 0, &src, &rep) != 0)
+                    return;
+                rep.arrival_lag_ms = arr.max_lag / 1e6;
+                printf("%10d %7d %8.3f ms %8.3f ms %10.0f %6.1f ms\n", CFG.rate, n, rep.turn_p50_ms,
+                       rep.turn_p99_ms, rep.secs > 0 ? rep.actions / rep.secs : 0.0, rep.arrival_lag_ms);
+
+                if (base_p99 < 0)
+                    base_p99 = rep.turn_p99_ms;
+                double interval_ms = 1000.0 / CFG.rate * (CFG.load == LOAD_BURST ? CFG.burst : 1);
+                int knee = (rep.turn_p99_ms > SAT_KNEE_FACTOR * base_p99 && rep.turn_p99_ms > 1.0) ||
+                           rep.arrival_lag_ms > 0.2 * interval_ms * n;
+                if (knee)
+                {
+                    r.knee_rate = CFG.rate;
+                    r.knee_p99_ms = rep.turn_p99_ms;
+                    break;
+                }
+                r.sustainable = CFG.rate;
+                rate *= SAT_RAMP;
+            }
+            results[n_results++] = r;
+        }
+
+    printf("\n=== Saturación: mesas/s sostenibles (p99 base x%.0f) ===\n", SAT_KNEE_FACTOR);
+    printf("%-13s %-18s %12s %14s\n", "Política", "Validador", "Sostenible", "Rodilla (p99)");
+    for (int i = 0; i < n_results; i++)
+    {
+        sat_result_t *r = &results[i];
+        printf("%-12s %-*s %10.0f/s ", policy_name(r->policy), r->bp ? 19 : 18, r->bp ? "contrapresión" : "base",
+               r->sustainable);
+        if (r->knee_rate > 0)
+            printf("%6.0f/s (%.2f ms)\n", r->knee_rate, r->knee_p99_ms);
+        else
+            printf("%14s\n", "no alcanzada");
+    }
+}
+
+/* ===== autoajuste (--autotune) =====
+ * Busca los parámetros del planificador y del supervisor que dan más
+ * acciones/s sobre una carga fija. La carga es de --tables mesas (200 si falta) y toma de
+ * la línea de comandos la semilla, las llegadas, el think time, el juego y la
+ * estrategia. Cada configuración se mide --autotune-reps veces y se queda la
+ * mediana.
+ * La búsqueda es por coordenadas desde la configuración actual. Cada parámetro
+ * ordinal prueba sus vecinos en la rejilla y sigue en la dirección que mejora.
+ * Los categóricos (política y supervisor) prueban todos sus valores. Un cambio
+ * se acepta si gana al menos AT_MIN_GAIN sin forzar más turnos por quantum
+ * agotado que la mejor hasta ahora, y se repiten pasadas hasta que
+ * ninguna mejora. Las configuraciones ya medidas no se repiten. La mejor se
+ * escribe como fichero de --config, con la frontera acciones/s - p99 en
+ * comentarios.
+ * El objetivo es acciones/s y no mesas/s porque la política elige el orden
+ * de turno y con él cambia la partida: las que la acortan (más pasos en
+ * FCFS/RR que en SJF_POINTS, por ejemplo) ganarían en mesas/s sin servir más
+ * rápido. Por lo mismo el quantum no entra en la búsqueda: uno corto fuerza
+ * jugadas y acaba antes las partidas, pero ya no son las mismas partidas.
+ */
+#define AT_MIN_GAIN 0.02
+#define AT_MAX_PASSES 4
+#define AT_MAX_EVALS 256
+#define AT_MAX_VALUES 12
+
+typedef enum
+{
+    AT_POLICY,
+    AT_AUTO,
+    AT_COOLDOWN,
+    AT_BLOCKED,
+    AT_QUEUE,
+    AT_SUPERVISOR,
+    AT_POLL,
+    AT_PIMC_THREADS,
+    AT_KNOBS
+} at_knob_id_t;
+
+typedef struct
+{
+    const char *name; // opción sin "--"
+    int ordinal;      // valores ordenados: se exploran por vecinos
+    int n;
+    int values[AT_MAX_VALUES];
+} at_knob_t;
+
+static at_knob_t AT_SPACE[AT_KNOBS] = {
+    [AT_POLICY] = {"policy", 0, 4, {FCFS, SJF_PLAYERS, SJF_POINTS, RR}},
+    [AT_AUTO] = {"auto", 0, 2, {1, 0}},
+    [AT_COOLDOWN] = {"cooldown-ms", 1, 5, {0, 1, 2, 5, 10}},
+    [AT_BLOCKED] = {"blocked-cooldown-ms", 1, 6, {0, 5, 15, 40, 75, 150}},
+    [AT_QUEUE] = {"queue-cap", 1, 6, {32, 128, 512, 1024, 4096, 16384}},
+    [AT_SUPERVISOR] = {"supervisor-ms", 1, 6, {5, 10, 25, 50, 100, 250}},
+    [AT_POLL] = {"policy-poll-ms", 1, 5, {1, 5, 20, 50, 100}},
+    [AT_PIMC_THREADS] = {"pimc-threads", 1, 0, {0}}, // solo con --strategy=pimc
+};
+
+typedef struct
+{
+    uint8_t pick[AT_KNOBS]; // índice en AT_SPACE[k].values
+    double tables_s, actions_s, p50_ms, p99_ms;
+    long forced; // turnos forzados por quantum agotado
+} at_eval_t;
+
+static at_eval_t AT_EVALS[AT_MAX_EVALS];
+static int AT_N_EVALS;
+static int AT_TRIAL_TABLES;
+
+// valor actual de CFG para el parámetro k
+static int at_current(int k)
+{
+    switch ((at_knob_id_t)k)
+    {
+    case AT_POLICY:
+        return CFG.default_policy;
+    case AT_AUTO:
+        return CFG.auto_policy;
+    case AT_COOLDOWN:
+        return CFG.turn_cooldown_ms;
+    case AT_BLOCKED:
+        return CFG.blocked_cooldown_ms;
+    case AT_QUEUE:
+        return CFG.queue_cap;
+    case AT_SUPERVISOR:
+        return CFG.supervisor_ms;
+    case AT_POLL:
+        return CFG.policy_poll_ms;
+    case AT_PIMC_THREADS:
+        return CFG.pimc_threads;
+    case AT_KNOBS:
+        break;
+    }
+    return 0;
+}
+
+static void at_apply(const uint8_t *pick)
+{
+    int v[AT_KNOBS];
+    for (int k = 0; k < AT_KNOBS; k++)
+        v[k] = AT_SPACE[k].n ? AT_SPACE[k].values[pick[k]] : at_current(k);
+    CFG.default_policy = (policy_t)v[AT_POLICY];
+    CFG.auto_policy = v[AT_AUTO];
+    CFG.turn_cooldown_ms = v[AT_COOLDOWN];
+    CFG.blocked_cooldown_ms = v[AT_BLOCKED];
+    CFG.queue_cap = v[AT_QUEUE];
+    CFG.supervisor_ms = v[AT_SUPERVISOR];
+    CFG.policy_poll_ms = v[AT_POLL];
+    CFG.pimc_threads = v[AT_PIMC_THREADS];
+}
+
+// índice del valor actual en la rejilla; si no está, se inserta en orden
+static int at_start_index(int k)
+{
+    at_knob_t *kn = &AT_SPACE[k];
+    int cur = at_current(k), i = 0;
+    while (i < kn->n && (kn->ordinal ? kn->values[i] < cur : kn->values[i] != cur))
+        i++;
+    if (i < kn->n && kn->values[i] == cur)
+        return i;
+    if (kn->n == AT_MAX_VALUES)
+        return i < kn->n ? i : kn->n - 1; // rejilla llena: el vecino más cercano por arriba
+    memmove(&kn->values[i + 1], &kn->values[i], sizeof(int) * (kn->n - i));
+    kn->values[i] = cur;
+    kn->n++;
+    return i;
+}
+
+// "opción=valor" tal como se escribe en el fichero de --config
+static void at_format(const uint8_t *pick, int k, char *buf, size_t len)
+{
+    int v = AT_SPACE[k].values[pick[k]];
+    if (k == AT_POLICY)
+        snprintf(buf, len, "policy=%s", policy_name((policy_t)v));
+    else if (k == AT_AUTO)
+        snprintf(buf, len, "%s", v ? "auto" : "no-auto");
+    else
+        snprintf(buf, len, "%s=%d", AT_SPACE[k].name, v);
+}
+
+static void at_describe(const uint8_t *pick, char *buf, size_t len)
+{
+    size_t used = 0;
+    buf[0] = '\0';
+    for (int k = 0; k < AT_KNOBS && used < len; k++)
+    {
+        if (!AT_SPACE[k].n)
             continue;
-        game_state_t *g = &tables[act.table_id];
+        char item[48];
+        at_format(pick, k, item, sizeof(item));
+        used += (size_t)snprintf(buf + used, len - used, "%s%s", used ? " " : "", item);
+    }
+}
+
+static double at_actions_s(const run_report_t *r) { return r->secs > 0 ? r->actions / r->secs : 0.0; }
+
+static int at_cmp_actions_s(const void *a, const void *b)
+{
+    double x = at_actions_s((const run_report_t *)a), y = at_actions_s((const run_report_t *)b);
+    return (x > y) - (x < y);
+}
+
+// mide una configuración, o devuelve la medida ya hecha; NULL si se agotó el presupuesto
+static const at_eval_t *at_measure(const uint8_t *pick)
+{
+    for (int i = 0; i < AT_N_EVALS; i++)
+        if (memcmp(AT_EVALS[i].pick, pick, AT_KNOBS) == 0)
+            return &AT_EVALS[i];
+    if (AT_N_EVALS == AT_MAX_EVALS)
+        return NULL;
+
+    at_apply(pick);
+    int n_reps = CFG.autotune_reps;
+    run_report_t *reps = calloc(n_reps, sizeof(run_report_t));
+    if (!reps)
+    {
+        perror("calloc");
+        exit(1);
+    }
+    for (int r = 0; r < n_reps; r++)
+    {
+        // mismas llegadas y repartos en cada repetición y configuración
+        arrival_source_t arr = {.n = AT_TRIAL_TABLES, .rng = {.s = CFG.seed * 0x2545f4914f6cdd1dULL + 1}};
+        table_source_t src = {.next = arrival_next, .peek = arrival_peek, .ctx = &arr};
+        if (run_simulation(AT_TRIAL_TABLES, 0, &src, &reps[r]) != 0)
+            exit(1);
+    }
+    qsort(reps, n_reps, sizeof(reps[0]), at_cmp_actions_s);
+    const run_report_t *med = &reps[n_reps / 2];
+
+    at_eval_t *e = &AT_EVALS[AT_N_EVALS++];
+    memcpy(e->pick, pick, AT_KNOBS);
+    e->tables_s = med->secs > 0 ? med->n_tables / med->secs : 0.0;
+    e->actions_s = at_actions_s(med);
+    e->p50_ms = med->turn_p50_ms;
+    e->p99_ms = med->turn_p99_ms;
+    e->forced = med->forced;
+    free(reps);
+
+    char desc[256];
+    at_describe(pick, desc, sizeof(desc));
+    printf("%4d %9.1f %10.0f %8.3f %8.3f %8ld  %s\n", AT_N_EVALS, e->tables_s, e->actions_s, e->p50_ms, e->p99_ms,
+           e->forced, desc);
+    return e;
+}
+
+// mide 'best' con el parámetro k en su valor v y se queda con él si gana AT_MIN_GAIN
+static int at_try(const at_eval_t **best, int k, int v, int *exhausted)
+{
+    uint8_t cand[AT_KNOBS];
+    memcpy(cand, (*best)->pick, AT_KNOBS);
+    cand[k] = (uint8_t)v;
+    const at_eval_t *e = at_measure(cand);
+    if (!e)
+    {
+        *exhausted = 1;
+        return 0;
+    }
+    if (e->actions_s <= (*best)->actions_s * (1.0 + AT_MIN_GAIN) || e->forced > (*best)->forced)
+        return 0;
+    *best = e;
+    return 1;
+}
+
+// frontera: configuraciones que ninguna otra supera en acciones/s y en p99 a la vez
+static int at_frontier(int *out)
+{
+    int n = 0;
+    for (int i = 0; i < AT_N_EVALS; i++)
+    {
+        const at_eval_t *a = &AT_EVALS[i];
+        int dominated = 0;
+        for (int j = 0; j < AT_N_EVALS && !dominated; j++)
+        {
+            const at_eval_t *b = &AT_EVALS[j];
+            dominated = j != i && b->actions_s >= a->actions_s && b->p99_ms <= a->p99_ms &&
+                        (b->actions_s > a->actions_s || b->p99_ms < a->p99_ms);
+        }
+        if (!dominated)
+            out[n++] = i;
+    }
+    // de más a menos acciones/s
+    for (int i = 1; i < n; i++)
+        for (int j = i; j > 0 && AT_EVALS[out[j]].actions_s > AT_EVALS[out[j - 1]].actions_s; j--)
+        {
+            int t = out[j];
+            out[j] = out[j - 1];
+            out[j - 1] = t;
+        }
+    return n;
+}
+
+static int at_write_config(const char *path, const at_eval_t *best, const int *front, int n_front)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror(path);
+        return 1;
+    }
+    fprintf(f, "# domino: configuración elegida por --autotune\n");
+    fprintf(f, "# carga: %d mesas, semilla %u, doble-%d, hasta %d jugadores, estrategia %s\n", AT_TRIAL_TABLES,
+            CFG.seed, CFG.pips, CFG.max_players, CFG.strategy == STRAT_PIMC ? "pimc" : "first");
+    fprintf(f, "# medida: %.0f acciones/s, %.1f mesas/s, turno p50 %.3f ms, p99 %.3f ms\n", best->actions_s,
+            best->tables_s, best->p50_ms, best->p99_ms);
+    fprintf(f, "# uso: domino --config=%s [opciones]\n", path);
+    for (int k = 0; k < AT_KNOBS; k++)
+    {
+        if (!AT_SPACE[k].n)
+            continue;
+        char item[48];
+        at_format(best->pick, k, item, sizeof(item));
+        if (k == AT_AUTO && AT_SPACE[k].values[best->pick[k]])
+            fprintf(f, "# supervisor automático activo (por defecto)\n");
+        else
+            fprintf(f, "%s\n", item);
+    }
+    fprintf(f, "\n# frontera acciones/s - p99 (%d configuraciones medidas)\n", AT_N_EVALS);
+    fprintf(f, "# mesas/s  acciones/s  p50 ms  p99 ms  configuración\n");
+    for (int i = 0; i < n_front; i++)
+    {
+        const at_eval_t *e = &AT_EVALS[front[i]];
+        char desc[256];
+        at_describe(e->pick, desc, sizeof(desc));
+        fprintf(f, "# %8.1f %11.0f %7.3f %7.3f  %s\n", e->tables_s, e->actions_s, e->p50_ms, e->p99_ms, desc);
+    }
+    fclose(f);
+    return 0;
+}
+
+static int autotune(void)
+{
+    AT_TRIAL_TABLES = CFG.n_tables > 0 ? CFG.n_tables : 200;
+    if (CFG.strategy == STRAT_PIMC)
+    {
+        // hilos del pool PIMC: 0, 1, 2, 4... hasta las CPUs menos el validador
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        int max = cpus > 2 ? (int)cpus - 1 : 1;
+        at_knob_t *kn = &AT_SPACE[AT_PIMC_THREADS];
+        kn->values[kn->n++] = 0;
+        for (int t = 1; t < max && kn->n < AT_MAX_VALUES - 1; t *= 2)
+            kn->values[kn->n++] = t;
+        kn->values[kn->n++] = max;
+        if (CFG.pimc_threads < 0)
+            CFG.pimc_threads = max;
+    }
+
+    uint8_t cur[AT_KNOBS] = {0};
+    for (int k = 0; k < AT_KNOBS; k++)
+        if (AT_SPACE[k].n)
+            cur[k] = (uint8_t)at_start_index(k);
+
+    printf("\n--- Autoajuste: %d mesas por prueba, mediana de %d, semilla %u ---\n", AT_TRIAL_TABLES,
+           CFG.autotune_reps, CFG.seed);
+    printf("%4s %9s %10s %8s %8s %8s  %s\n", "#", "mesas/s", "acciones/s", "p50 ms", "p99 ms", "forzados",
+           "configuración");
+    const at_eval_t *best = at_measure(cur);
+    int exhausted = 0;
+    for (int pass = 0; pass < AT_MAX_PASSES && !exhausted; pass++)
+    {
+        int improved = 0;
+        for (int k = 0; k < AT_KNOBS && !exhausted; k++)
+        {
+            at_knob_t *kn = &AT_SPACE[k];
+            if (kn->n < 2)
+                continue;
+            if (!kn->ordinal)
+            {
+                for (int v = 0; v < kn->n && !exhausted; v++)
+                    if (v != best->pick[k])
+                        improved |= at_try(&best, k, v, &exhausted);
+                continue;
+            }
+            // ordinal: avanzar hacia abajo y luego hacia arriba mientras mejore
+            for (int dir = -1; dir <= 1; dir += 2)
+                for (int v = best->pick[k] + dir; v >= 0 && v < kn->n && !exhausted; v += dir)
+                {
+                    if (!at_try(&best, k, v, &exhausted))
+                        break;
+                    improved = 1;
+                }
+        }
+        if (!improved)
+            break;
+    }
+    int front[AT_MAX_EVALS];
+    int n_front = at_frontier(front);
+    char desc[256];
+    at_describe(best->pick, desc, sizeof(desc));
+    printf("\n=== Autoajuste: %d configuraciones medidas ===\n", AT_N_EVALS);
+    printf("Mejor: %.0f acciones/s (turno p99 %.3f ms)\n  %s\n", best->actions_s, best->p99_ms, desc);
+    printf("Frontera acciones/s - p99:\n");
+    for (int i = 0; i < n_front; i++)
+    {
+        const at_eval_t *e = &AT_EVALS[front[i]];
+        at_describe(e->pick, desc, sizeof(desc));
+        printf("  %10.0f acciones/s  p99 %8.3f ms  %s\n", e->actions_s, e->p99_ms, desc);
+    }
+    at_apply(best->pick);
+    if (at_write_config(CFG.autotune_out, best, front, n_front) != 0)
+        return 1;
+    printf("Configuración escrita en %s (úsala con --config=%s)\n", CFG.autotune_out, CFG.autotune_out);
+    return 0;
+}
+
+/* ===== experimento A/B con números aleatorios comunes (--experiment) =====
+ * Cada reparto del conjunto (N = --tables, derivado de --seed) se juega una
+ * vez por brazo: FCFS, SJF_PLAYERS, SJF_POINTS y RR con política fija, y AUTO
+ * (supervisor activo, arrancando en --policy). Todas las mesas corren en la
+ * misma simulación y los brazos de un reparto llegan juntos, así que comparten
+ * reparto, think times y carga del validador: solo cambia la política. Cada
+ * brazo se compara reparto a reparto contra el de --policy: longitud y
+ * latencia con prueba z pareada (IC 95%), cierres por bloqueo con McNemar y
+ * asiento ganador con chi-cuadrado de homogeneidad.
+ */
+#define EXP_ARMS 5
+#define EXP_AUTO 4 // brazo con supervisor automático
+
+static const char *const EXP_ARM_NAMES[EXP_ARMS] = {"FCFS", "SJF_PLAYERS", "SJF_POINTS", "RR", "AUTO"};
+static const policy_t EXP_ARM_POLICY[EXP_ARMS - 1] = {FCFS, SJF_PLAYERS, SJF_POINTS, RR};
+
+static table_result_t *EXP_RESULTS; // indexado por gid = reparto * EXP_ARMS + brazo
+
+typedef struct
+{
+    int n_deals, i;
+    rng_t rng;
+    long long due;
+} exp_source_t;
+
+static void exp_on_result(const table_result_t *r) { EXP_RESULTS[r->gid] = *r; }
+
+static void exp_spec(int i, table_spec_t *out)
+{
+    int deal = i / EXP_ARMS, arm = i % EXP_ARMS;
+    out->gid = i;
+    out->seed = table_seed(CFG.seed, deal);
+    out->nplayers = table_players(out->seed);
+    out->policy = (uint8_t)(arm == EXP_AUTO ? CFG.default_policy : EXP_ARM_POLICY[arm]);
+    out->auto_policy = arm == EXP_AUTO;
+}
 
-        pthread_mutex_lock(&g->mtx);
-        if (g->finished)
+static int exp_peek(table_source_t *src, int idx, table_spec_t *out)
+{
+    exp_source_t *e = (exp_source_t *)src->ctx;
+    if (idx >= e->n_deals * EXP_ARMS)
+        return 0;
+    exp_spec(idx, out);
+    return 1;
+}
+
+static int exp_next(table_source_t *src, table_spec_t *out)
+{
+    exp_source_t *e = (exp_source_t *)src->ctx;
+    if (e->i >= e->n_deals * EXP_ARMS)
+        return 0;
+    int deal = e->i / EXP_ARMS, arm = e->i % EXP_ARMS;
+    if (arm == 0)
+    {
+        // el proceso de llegadas rige por reparto; sus brazos entran a la vez
+        e->due = deal == 0 ? now_ns() : e->due + next_arrival_gap_ns(&e->rng, deal);
+        long long now = now_ns();
+        if (e->due > now)
+            sleep_ns(e->due - now);
+    }
+    exp_spec(e->i, out);
+    e->i++;
+    return 1;
+}
+
+// P(Z > z) de la normal estándar
+static double norm_sf(double z) { return 0.5 * erfc(z / sqrt(2.0)); }
+
+// P(X > x) de una chi-cuadrado con k grados de libertad (forma cerrada para k entero)
+static double chi2_sf(double x, int k)
+{
+    if (x <= 0.0 || k <= 0)
+        return 1.0;
+    double h = x / 2.0, sum, term;
+    if (k % 2 == 0)
+    {
+        sum = term = exp(-h);
+        for (int i = 1; i < k / 2; i++)
         {
-            pthread_mutex_unlock(&g->mtx);
-            continue;
+            term *= h / i;
+            sum += term;
         }
-        if (g->turn != act.player_id)
-        {
-            pthread_mutex_unlock(&g->mtx);
+        return sum;
+    }
+    sum = erfc(sqrt(h));
+    term = 2.0 * sqrt(h / M_PI) * exp(-h); // h^(1/2) e^-h / Gamma(3/2)
+    for (int i = 1; i <= (k - 1) / 2; i++)
+    {
+        sum += term;
+        term *= h / (i + 0.5);
+    }
+    return sum;
+}
+
+// diferencias pareadas brazo - referencia
+typedef struct
+{
+    long n;
+    double sum, sumsq;
+} paired_t;
+
+static void paired_add(paired_t *p, double d)
+{
+    p->n++;
+    p->sum += d;
+    p->sumsq += d * d;
+}
+
+// media, semiancho del IC 95% y p bilateral (aproximación normal: n grande)
+static double paired_mean(const paired_t *p, double *ci, double *pval)
+{
+    double mean = p->n ? p->sum / p->n : 0.0;
+    double var = p->n > 1 ? (p->sumsq - p->n * mean * mean) / (p->n - 1) : 0.0;
+    double se = var > 0.0 ? sqrt(var / p->n) : 0.0;
+    *ci = 1.96 * se;
+    *pval = se > 0.0 ? 2.0 * norm_sf(fabs(mean) / se) : (mean == 0.0 ? 1.0 : 0.0);
+    return mean;
+}
+
+// McNemar con corrección de continuidad; b, c = pares discordantes
+static double mcnemar_p(long b, long c)
+{
+    if (b + c == 0)
+        return 1.0;
+    double d = fabs((double)(b - c)) - 1.0;
+    return chi2_sf(d > 0.0 ? d * d / (b + c) : 0.0, 1);
+}
+
+// homogeneidad 2 x K de los asientos ganadores (columna K: sin ganador)
+static double winner_chi2_p(const long a[MAX_PLAYERS + 1], const long b[MAX_PLAYERS + 1])
+{
+    long na = 0, nb = 0;
+    for (int k = 0; k <= MAX_PLAYERS; k++)
+    {
+        na += a[k];
+        nb += b[k];
+    }
+    double x = 0.0;
+    int cols = 0;
+    for (int k = 0; k <= MAX_PLAYERS; k++)
+    {
+        long col = a[k] + b[k];
+        if (col == 0)
             continue;
-        }
+        cols++;
+        double ea = (double)na * col / (na + nb), eb = (double)nb * col / (na + nb);
+        x += (a[k] - ea) * (a[k] - ea) / ea + (b[k] - eb) * (b[k] - eb) / eb;
+    }
+    return chi2_sf(x, cols - 1);
+}
 
-        // aplicar una única acción
-        if (act.kind == ACT_PLAY)
+static const char *end_reason_name(int r)
+{
+    switch (r)
+    {
+    case END_DOMINA:
+        return "domina";
+    case END_BLOCKED:
+        return "bloqueo";
+    case END_STEP_LIMIT:
+        return "limite";
+    }
+    return "-";
+}
+
+static void exp_write_csv(const char *path, int n_deals)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+    {
+        perror("fopen experiment csv");
+        return;
+    }
+    fprintf(f, "reparto,semilla,jugadores,brazo,politica_final,pasos,fin,ganador,");
+    for (int p = 0; p < CFG.max_players; p++)
+        fprintf(f, "puntos%d,", p);
+    fprintf(f, "duracion_us,turno_medio_us\n");
+    for (int d = 0; d < n_deals; d++)
+        for (int a = 0; a < EXP_ARMS; a++)
         {
-            if (act.idx_in_hand >= 0 && act.idx_in_hand < g->hand_len[act.player_id])
-            {
-                tile_t t = g->hands[act.player_id][act.idx_in_hand];
-                int ok = (act.side < 0) ? (t.a == g->left_end || t.b == g->left_end)
-                                        : (t.a == g->right_end || t.b == g->right_end);
-                if (ok)
-                {
-                    apply_play(g, act.player_id, act.idx_in_hand, act.side);
-                    // pass_streak=0 está dentro de apply_play ✓
-                    if (g->hand_len[act.player_id] == 0)
-                    {
-                        printf("=== Mesa %d | J%d DOMINA. FIN ===\n", g->table_id, act.player_id);
-                        g->finished = 1;
-                    }
-                }
+            const table_result_t *r = &EXP_RESULTS[d * EXP_ARMS + a];
+            fprintf(f, "%d,%u,%d,%s,%s,%d,%s,%d", d, r->seed, r->nplayers, EXP_ARM_NAMES[a],
+                    policy_name((policy_t)r->policy), r->steps, end_reason_name(r->end_reason), r->winner);
+            for (int p = 0; p < CFG.max_players; p++)
+                if (p < r->nplayers)
+                    fprintf(f, ",%d", r->points[p]);
                 else
-                {
-                    // Jugada inválida: no resetear pass_streak aquí
-                    if (g->pool_len > 0)
-                        apply_draw(g, act.player_id);
-                    else
-                        apply_pass(g, act.player_id);
-                }
-            }
+                    fprintf(f, ",");
+            fprintf(f, ",%u,%.3f\n", r->duration_us, r->turn_mean_ns / 1e3);
         }
-        else if (act.kind == ACT_DRAW)
-        {
-            if (g->pool_len > 0)
-                apply_draw(g, act.player_id);
-            else
-                apply_pass(g, act.player_id);
-        }
-        else if (act.kind == ACT_PASS)
+    fclose(f);
+    printf("CSV del experimento: %s (%d filas)\n", path, n_deals * EXP_ARMS);
+}
+
+static void exp_report(int n_deals)
+{
+    int ref = 0;
+    for (int a = 0; a < EXP_ARMS - 1; a++)
+        if (EXP_ARM_POLICY[a] == CFG.default_policy)
+            ref = a;
+
+    printf("\n=== Experimento A/B: %d repartos x %d brazos, semilla %u ===\n", n_deals, EXP_ARMS, CFG.seed);
+    printf("Brazo         pasos  bloqueo   límite");
+    for (int p = 0; p < CFG.max_players; p++)
+        printf("     J%d", p);
+    printf("  turno medio\n");
+    long wins[EXP_ARMS][MAX_PLAYERS + 1];
+    memset(wins, 0, sizeof(wins));
+    for (int a = 0; a < EXP_ARMS; a++)
+    {
+        double steps = 0.0, lat = 0.0;
+        long blocked = 0, limit = 0, timed = 0;
+        for (int d = 0; d < n_deals; d++)
         {
-            apply_pass(g, act.player_id);
+            const table_result_t *r = &EXP_RESULTS[d * EXP_ARMS + a];
+            steps += r->steps;
+            if (!r->cached)
+            {
+                lat += r->turn_mean_ns / 1e6;
+                timed++;
+            }
+            blocked += r->end_reason == END_BLOCKED;
+            limit += r->end_reason == END_STEP_LIMIT;
+            wins[a][r->winner >= 0 ? r->winner : MAX_PLAYERS]++;
         }
+        printf("%-12s %6.1f %7.1f%% %7.1f%%", EXP_ARM_NAMES[a], steps / n_deals, 100.0 * blocked / n_deals,
+               100.0 * limit / n_deals);
+        for (int p = 0; p < CFG.max_players; p++)
+            printf(" %5.1f%%", 100.0 * wins[a][p] / n_deals);
+        if (timed)
+            printf(" %8.3f ms\n", lat / timed);
+        else
+            printf(" %11s\n", "caché");
+    }
 
-        g->steps++;
-        if (!g->finished && g->steps >= g->max_steps)
+    printf("\n--- Diferencias pareadas contra %s (media ± IC 95%%, p bilateral, * si p < 0.05) ---\n",
+           EXP_ARM_NAMES[ref]);
+    printf("Brazo               Δ pasos        p    Δ bloqueo        p  ganador ≠        p"
+           "  Δ turno medio (ms)        p\n");
+    for (int a = 0; a < EXP_ARMS; a++)
+    {
+        if (a == ref)
+            continue;
+        paired_t steps = {0}, lat = {0};
+        long b = 0, c = 0, changed = 0;
+        for (int d = 0; d < n_deals; d++)
         {
-            printf("=== Mesa %d | FIN forzado por límite de pasos ===\n", g->table_id);
-            g->finished = 1;
+            const table_result_t *x = &EXP_RESULTS[d * EXP_ARMS + a], *y = &EXP_RESULTS[d * EXP_ARMS + ref];
+            paired_add(&steps, (double)x->steps - y->steps);
+            if (!x->cached && !y->cached) // la latencia solo existe en mesas jugadas
+                paired_add(&lat, (x->turn_mean_ns - (double)y->turn_mean_ns) / 1e6);
+            int xb = x->end_reason == END_BLOCKED, yb = y->end_reason == END_BLOCKED;
+            b += xb && !yb;
+            c += !xb && yb;
+            changed += x->winner != y->winner;
         }
+        double ci_s, p_s, ci_l, p_l;
+        double ds = paired_mean(&steps, &ci_s, &p_s), dl = paired_mean(&lat, &ci_l, &p_l);
+        double p_b = mcnemar_p(b, c), p_w = winner_chi2_p(wins[a], wins[ref]);
+        printf("%-12s %6.2f ± %5.2f %7.4f%s %+9.1f%% %7.4f%s %8.1f%% %7.4f%s", EXP_ARM_NAMES[a], ds, ci_s, p_s,
+               p_s < 0.05 ? "*" : " ", 100.0 * (b - c) / n_deals, p_b, p_b < 0.05 ? "*" : " ",
+               100.0 * changed / n_deals, p_w, p_w < 0.05 ? "*" : " ");
+        if (lat.n)
+            printf(" %8.3f ± %6.3f %7.4f%s\n", dl, ci_l, p_l, p_l < 0.05 ? "*" : " ");
+        else
+            printf(" %19s\n", "sin pares jugados");
+    }
+    if (n_deals < 30)
+        puts("Aviso: con menos de 30 repartos los p-valores (aproximación normal) son optimistas.");
+}
 
-        // marcar fin de "turno planificado" y notificar
-        g->action_done = 1;
-        pthread_cond_broadcast(&g->cv);
-        pthread_mutex_unlock(&g->mtx);
+static int run_experiment(int n_deals)
+{
+    EXP_RESULTS = calloc((size_t)n_deals * EXP_ARMS, sizeof(table_result_t));
+    if (!EXP_RESULTS)
+    {
+        perror("alloc");
+        return 1;
     }
-    return NULL;
+    RESULT_HOOK = exp_on_result;
+    exp_source_t e = {.n_deals = n_deals, .rng = {.s = CFG.seed * 0x2545f4914f6cdd1dULL + 1}};
+    table_source_t src = {.next = exp_next, .peek = exp_peek, .ctx = &e};
+    run_report_t rep;
+    printf("Experimento A/B: %d repartos x %d brazos = %d mesas simultáneas\n", n_deals, EXP_ARMS,
+           n_deals * EXP_ARMS);
+    if (run_simulation(n_deals * EXP_ARMS, 0, &src, &rep) != 0)
+        return 1;
+    RESULT_HOOK = NULL;
+    printf("Simulación: %.2f s, %ld acciones, turno p50=%.3f ms p99=%.3f ms\n", rep.secs, rep.actions,
+           rep.turn_p50_ms, rep.turn_p99_ms);
+    exp_report(n_deals);
+    oc_print_stats();
+    if (CFG.experiment_csv)
+        exp_write_csv(CFG.experiment_csv, n_deals);
+    free(EXP_RESULTS);
+    EXP_RESULTS = NULL;
+    return 0;
 }
 
-/* ===== control en caliente (consola) ===== */
+/* ===== almacén de resultados columnar (--results / --query) =====
+ * Fichero de solo añadir con una fila por mesa terminada, organizado por
+ * columnas en bloques de RS_CHUNK_ROWS filas. Formato fijo, little-endian,
+ * versión 1:
+ *
+ *   offset 0     rs_header_t (ocupa RS_HEADER_BYTES; rows = filas confirmadas)
+ *   offset 4096  bloque 0, bloque 1, ... (rs_col_off(RS_NCOLS) bytes cada uno)
+ *
+ * Dentro de un bloque cada columna ocupa RS_CHUNK_ROWS * ancho bytes
+ * contiguos, en el orden de rs_col_t. Los puntos son 'seats' columnas de
+ * uint16_t, una por asiento. Una consulta lee solo sus columnas, en tramos
+ * secuenciales de un bloque. Escribe un único proceso: el que juega las mesas
+ * o, con --workers, el coordinador. Cada fila se escribe columna a columna y
+ * luego se publica rows con release, así que un lector concurrente no ve
+ * filas a medias. Cada bloque se reserva con ftruncate antes de su primera
+ * fila. Si el proceso muere, lo que pase de rows se sobrescribe al reabrir.
+ */
+#define RS_MAGIC 0x315345524D4F44ULL // "DOMRES1" en disco (little-endian)
+#define RS_VERSION 1
+#define RS_HEADER_BYTES 4096
+#define RS_CHUNK_ROWS 65536 // múltiplo de 4096: los bloques quedan alineados a página
+#define RS_MAX_SEATS 16
 
-void *control_thread(void *arg)
+typedef enum
 {
-    control_args_t *ca = (control_args_t *)arg;
+    RS_SEED,     // uint32: semilla del reparto
+    RS_PLAYERS,  // uint8
+    RS_POLICY0,  // uint8: política inicial
+    RS_POLICY,   // uint8: política final
+    RS_SWITCHES, // uint8: cambios de política
+    RS_STEPS,    // uint16
+    RS_END,      // uint8: end_reason_t
+    RS_WINNER,   // int8: -1 sin ganador
+    RS_CACHED,   // uint8: resultado servido por la caché
+    RS_DURATION, // uint32: µs
+    RS_POINTS,   // uint16 x seats: puntos en mano al terminar
+    RS_NCOLS
+} rs_col_t;
+
+static const uint8_t RS_WIDTH[RS_NCOLS] = {4, 1, 1, 1, 1, 2, 1, 1, 1, 4, 2};
 
-    printf("\n[Supervisor automático] Iniciando monitoreo de mesas...\n");
+typedef struct
+{
+    uint64_t magic;
+    uint32_t version, seats;
+    uint32_t chunk_rows, ncols;
+    _Atomic uint64_t rows; // filas confirmadas
+    uint8_t width[RS_NCOLS];
+} rs_header_t;
+
+typedef struct
+{
+    rs_header_t *hdr; // NULL => almacén desactivado
+    int fd, seats;
+    size_t off[RS_NCOLS + 1]; // desplazamiento de cada columna en el bloque; el último es el tamaño
+    uint8_t *chunk;           // bloque mapeado para escribir
+    uint64_t chunk_idx;
+    long appended;
+    pthread_mutex_t mtx;
+    const char *path;
+} results_store_t;
+
+static results_store_t RS = {.fd = -1};
+
+static void rs_layout(size_t *off, int seats)
+{
+    off[0] = 0;
+    for (int c = 0; c < RS_NCOLS; c++)
+        off[c + 1] = off[c] + (size_t)RS_WIDTH[c] * (c == RS_POINTS ? seats : 1) * RS_CHUNK_ROWS;
+}
 
-    while (!all_tables_finished(ca->tables, ca->n_tables))
+static int rs_open(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
     {
-        for (int i = 0; i < ca->n_tables; ++i)
+        perror(path);
+        return -1;
+    }
+    // un solo escritor por almacén: dos procesos añadiendo a la vez se pisarían
+    // las filas (el cerrojo se suelta solo al cerrar o al salir)
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        if (errno == EWOULDBLOCK)
+            fprintf(stderr, "%s: otro proceso ya está escribiendo en este almacén de resultados\n", path);
+        else
+            perror("flock(results)");
+        close(fd);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (st.st_size < RS_HEADER_BYTES && ftruncate(fd, RS_HEADER_BYTES) != 0))
+    {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, RS_HEADER_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        perror("mmap(results)");
+        close(fd);
+        return -1;
+    }
+    rs_header_t *h = (rs_header_t *)p;
+    if (h->magic == 0)
+    {
+        h->version = RS_VERSION;
+        h->seats = MAX_PLAYERS;
+        h->chunk_rows = RS_CHUNK_ROWS;
+        h->ncols = RS_NCOLS;
+        memcpy(h->width, RS_WIDTH, sizeof(RS_WIDTH));
+        atomic_store_explicit(&h->rows, 0, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        h->magic = RS_MAGIC;
+    }
+    else if (h->magic != RS_MAGIC || h->version != RS_VERSION || h->chunk_rows != RS_CHUNK_ROWS ||
+             h->ncols != RS_NCOLS || memcmp(h->width, RS_WIDTH, sizeof(RS_WIDTH)) != 0 || h->seats < MAX_PLAYERS ||
+             h->seats > RS_MAX_SEATS)
+    {
+        fprintf(stderr, "%s no es un almacén de resultados v%d compatible (%d asientos o más)\n", path, RS_VERSION,
+                MAX_PLAYERS);
+        munmap(p, RS_HEADER_BYTES);
+        close(fd);
+        return -1;
+    }
+    RS.hdr = h;
+    RS.fd = fd;
+    RS.seats = (int)h->seats;
+    rs_layout(RS.off, RS.seats);
+    RS.chunk = NULL;
+    RS.appended = 0;
+    RS.path = path;
+    pthread_mutex_init(&RS.mtx, NULL);
+    printf("[Resultados] %s: %llu filas previas\n", path, (unsigned long long)atomic_load(&h->rows));
+    return 0;
+}
+
+static void rs_append(const table_result_t *r)
+{
+    if (!RS.hdr)
+        return;
+    MTX_LOCK(&RS.mtx, "resultados");
+    uint64_t row = atomic_load_explicit(&RS.hdr->rows, memory_order_relaxed);
+    uint64_t k = row / RS_CHUNK_ROWS;
+    size_t i = (size_t)(row % RS_CHUNK_ROWS);
+    size_t chunk_bytes = RS.off[RS_NCOLS];
+    if (!RS.chunk || RS.chunk_idx != k)
+    {
+        if (RS.chunk)
+            munmap(RS.chunk, chunk_bytes);
+        RS.chunk = NULL;
+        off_t off = RS_HEADER_BYTES + (off_t)(k * chunk_bytes);
+        struct stat st;
+        void *p = MAP_FAILED;
+        if (fstat(RS.fd, &st) == 0 &&
+            (st.st_size >= off + (off_t)chunk_bytes || ftruncate(RS.fd, off + (off_t)chunk_bytes) == 0))
+            p = mmap(NULL, chunk_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, RS.fd, off);
+        if (p == MAP_FAILED)
         {
-            game_state_t *g = &ca->tables[i];
-            policy_t desired_policy = FCFS;
-            int request_change = 0;
+            perror("results: bloque nuevo");
+            MTX_UNLOCK(&RS.mtx);
+            return;
+        }
+        RS.chunk = (uint8_t *)p;
+        RS.chunk_idx = k;
+    }
+    uint8_t *b = RS.chunk;
+    ((uint32_t *)(b + RS.off[RS_SEED]))[i] = r->seed;
+    b[RS.off[RS_PLAYERS] + i] = r->nplayers;
+    b[RS.off[RS_POLICY0] + i] = r->init_policy;
+    b[RS.off[RS_POLICY] + i] = r->policy;
+    b[RS.off[RS_SWITCHES] + i] = r->switches;
+    ((uint16_t *)(b + RS.off[RS_STEPS]))[i] = r->steps;
+    b[RS.off[RS_END] + i] = r->end_reason;
+    b[RS.off[RS_WINNER] + i] = (uint8_t)r->winner;
+    b[RS.off[RS_CACHED] + i] = (uint8_t)r->cached;
+    ((uint32_t *)(b + RS.off[RS_DURATION]))[i] = r->duration_us;
+    for (int p = 0; p < RS.seats; p++)
+        ((uint16_t *)(b + RS.off[RS_POINTS]))[(size_t)p * RS_CHUNK_ROWS + i] =
+            p < MAX_PLAYERS && p < r->nplayers ? r->points[p] : 0;
+    atomic_store_explicit(&RS.hdr->rows, row + 1, memory_order_release);
+    RS.appended++;
+    MTX_UNLOCK(&RS.mtx);
+}
 
-            pthread_mutex_lock(&g->mtx);
-            if (!g->finished)
-            {
-                if (evaluate_auto_policy(g, &desired_policy) && desired_policy != g->policy)
-                {
-                    request_change = 1;
-                }
-                else if (g->policy == FCFS)
-                {
-                    desired_policy = (g->nplayers >= 3) ? SJF_PLAYERS : SJF_POINTS;
-                    request_change = 1;
-                }
-            }
-            pthread_mutex_unlock(&g->mtx);
+static void rs_close(void)
+{
+    if (!RS.hdr)
+        return;
+    if (RS.chunk)
+        munmap(RS.chunk, RS.off[RS_NCOLS]);
+    printf("[Resultados] %ld filas añadidas a %s (%llu en total)\n", RS.appended, RS.path,
+           (unsigned long long)atomic_load(&RS.hdr->rows));
+    munmap(RS.hdr, RS_HEADER_BYTES);
+    close(RS.fd);
+    RS.hdr = NULL;
+    RS.chunk = NULL;
+    RS.fd = -1;
+}
 
-            if (request_change)
-                request_policy_change(i, desired_policy);
+/* ----- consulta: escaneo secuencial por columnas -----
+ * Cada hilo recorre los bloques t, t + n, t + 2n... con acumuladores propios
+ * y al final se suman. Solo se tocan las columnas de agrupación, fin, pasos,
+ * ganador y duración: 9 bytes por fila.
+ */
+#define RQ_GROUPS 256
+#define RQ_STEP_BINS 1024 // los pasos >= RQ_STEP_BINS - 1 caen en la última casilla
 
-            pthread_mutex_lock(&g->mtx);
-            if (!g->finished)
-            {
-                int desired_cooldown = (g->pass_streak >= g->nplayers) ? 75 : 0;
-                if (g->turn_cooldown_ms != desired_cooldown)
-                {
-                    g->turn_cooldown_ms = desired_cooldown;
-                    printf(">> Supervisor auto: Mesa %d ajusta cooldown = %d ms\n", i, desired_cooldown);
-                    pthread_cond_broadcast(&g->cv);
-                }
+typedef enum
+{
+    RQ_BY_POLICY0,
+    RQ_BY_POLICY,
+    RQ_BY_PLAYERS,
+    RQ_BY_SWITCHES,
+    RQ_BY_END
+} rq_by_t;
 
-                int desired_quantum = (g->policy == RR) ? 120 : 200;
-                if (g->rr_quantum_ms != desired_quantum)
-                {
-                    g->rr_quantum_ms = desired_quantum;
-                    printf(">> Supervisor auto: Mesa %d ajusta quantum = %d ms\n", i, desired_quantum);
-                }
-            }
-            pthread_mutex_unlock(&g->mtx);
-        }
+typedef struct
+{
+    uint64_t games[RQ_GROUPS];
+    uint64_t by_end[RQ_GROUPS][4];
+    uint64_t wins[RQ_GROUPS][RS_MAX_SEATS];
+    uint64_t dur_us[RQ_GROUPS];
+    uint64_t steps[RQ_GROUPS][RQ_STEP_BINS];
+} rq_acc_t;
 
-        sleep_ms(100);
-    }
+typedef struct
+{
+    const uint8_t *base; // primer bloque
+    const size_t *off;
+    uint64_t rows, n_chunks;
+    int seats, key_col, tid, n_threads;
+    rq_acc_t *acc;
+} rq_scan_t;
 
-    printf("[Supervisor automático] Finalizó el monitoreo: todas las mesas terminaron.\n");
+static void *rq_scan_thread(void *arg)
+{
+    rq_scan_t *s = (rq_scan_t *)arg;
+    rq_acc_t *a = s->acc;
+    size_t chunk_bytes = s->off[RS_NCOLS];
+    for (uint64_t k = (uint64_t)s->tid; k < s->n_chunks; k += (uint64_t)s->n_threads)
+    {
+        const uint8_t *b = s->base + k * chunk_bytes;
+        size_t n = s->rows - k * RS_CHUNK_ROWS < RS_CHUNK_ROWS ? (size_t)(s->rows - k * RS_CHUNK_ROWS) : RS_CHUNK_ROWS;
+        const uint8_t *key = b + s->off[s->key_col];
+        const uint8_t *end = b + s->off[RS_END];
+        const int8_t *win = (const int8_t *)(b + s->off[RS_WINNER]);
+        const uint16_t *steps = (const uint16_t *)(b + s->off[RS_STEPS]);
+        const uint32_t *dur = (const uint32_t *)(b + s->off[RS_DURATION]);
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned g = key[i];
+            a->games[g]++;
+            a->by_end[g][end[i] & 3]++;
+            a->steps[g][steps[i] < RQ_STEP_BINS ? steps[i] : RQ_STEP_BINS - 1]++;
+            a->dur_us[g] += dur[i];
+            if (win[i] >= 0 && win[i] < s->seats)
+                a->wins[g][win[i]]++;
+        }
+    }
     return NULL;
 }
 
-typedef struct
+static int rq_pct(const uint64_t *hist, uint64_t total, double q)
 {
-    game_state_t *tables;
-    int n_tables;
-} policy_supervisor_args_t;
+    uint64_t want = (uint64_t)ceil(q * total), seen = 0;
+    for (int b = 0; b < RQ_STEP_BINS; b++)
+        if ((seen += hist[b]) >= want && seen > 0)
+            return b;
+    return RQ_STEP_BINS - 1;
+}
 
-void *policy_supervisor_thread(void *arg)
+static void rq_label(int by, int g, char *buf, size_t len)
 {
-    policy_supervisor_args_t *psa = (policy_supervisor_args_t *)arg;
+    switch (by)
+    {
+    case RQ_BY_POLICY0:
+    case RQ_BY_POLICY:
+        snprintf(buf, len, "%s", policy_name((policy_t)g));
+        break;
+    case RQ_BY_PLAYERS:
+        snprintf(buf, len, "%d jugadores", g);
+        break;
+    case RQ_BY_SWITCHES:
+        snprintf(buf, len, "%d cambios", g);
+        break;
+    default:
+        snprintf(buf, len, "%s", end_reason_name(g));
+    }
+}
 
-    int stop_requested = 0;
-    for (;;)
+static void rq_print_row(const char *label, const rq_acc_t *a, int g, int seats)
+{
+    uint64_t n = a->games[g];
+    const uint64_t *h = a->steps[g];
+    double mean = 0.0;
+    int max = 0;
+    for (int b = 0; b < RQ_STEP_BINS; b++)
     {
-        policy_change_t change;
-        int popped = policy_q_try_pop(&POLICY_Q, &change);
-        if (popped == 1)
+        mean += (double)b * h[b];
+        if (h[b])
+            max = b;
+    }
+    printf("%-14s %11llu %6.1f%% %6.1f%% %6.1f%% %7.2f %5d %5d %5d %5d %9.3f ", label, (unsigned long long)n,
+           100.0 * a->by_end[g][END_DOMINA] / n, 100.0 * a->by_end[g][END_BLOCKED] / n,
+           100.0 * a->by_end[g][END_STEP_LIMIT] / n, mean / n, rq_pct(h, n, 0.50), rq_pct(h, n, 0.90),
+           rq_pct(h, n, 0.99), max, a->dur_us[g] / 1e3 / n);
+    for (int p = 0; p < seats; p++)
+        printf(" J%d=%4.1f", p, 100.0 * a->wins[g][p] / n);
+    printf("\n");
+}
+
+static int rs_query(const char *path, int by)
+{
+    static const int key_col[] = {RS_POLICY0, RS_POLICY, RS_PLAYERS, RS_SWITCHES, RS_END};
+    static const char *const by_title[] = {"Política ini.", "Política fin.", "Jugadores", "Cambios", "Fin"};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror(path);
+        return 1;
+    }
+    rs_header_t h;
+    struct stat st;
+    if (pread(fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || fstat(fd, &st) != 0 || h.magic != RS_MAGIC ||
+        h.version != RS_VERSION || h.chunk_rows != RS_CHUNK_ROWS || h.ncols != RS_NCOLS ||
+        memcmp(h.width, RS_WIDTH, sizeof(RS_WIDTH)) != 0 || h.seats == 0 || h.seats > RS_MAX_SEATS)
+    {
+        fprintf(stderr, "%s no es un almacén de resultados v%d\n", path, RS_VERSION);
+        close(fd);
+        return 1;
+    }
+    size_t off[RS_NCOLS + 1];
+    rs_layout(off, (int)h.seats);
+    uint64_t rows = atomic_load(&h.rows); // instantánea: lo que se añada después no se ve
+    uint64_t n_chunks = (rows + RS_CHUNK_ROWS - 1) / RS_CHUNK_ROWS;
+    size_t len = RS_HEADER_BYTES + n_chunks * off[RS_NCOLS];
+    if (rows == 0 || (off_t)len > st.st_size)
+    {
+        printf("[Consulta] %s: %llu filas\n", path, (unsigned long long)rows);
+        close(fd);
+        return rows == 0 ? 0 : 1;
+    }
+    void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        perror("mmap(results)");
+        return 1;
+    }
+    madvise(p, len, MADV_SEQUENTIAL);
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int n_threads = cpus > 0 ? (int)cpus : 1;
+    if ((uint64_t)n_threads > n_chunks)
+        n_threads = (int)n_chunks;
+    rq_scan_t *scans = calloc(n_threads, sizeof(rq_scan_t));
+    pthread_t *th = calloc(n_threads, sizeof(pthread_t));
+    rq_acc_t *acc = calloc(n_threads, sizeof(rq_acc_t));
+    if (!scans || !th || !acc)
+    {
+        perror("calloc");
+        return 1;
+    }
+    long long t0 = now_ns();
+    for (int t = 0; t < n_threads; t++)
+    {
+        scans[t] = (rq_scan_t){.base = (const uint8_t *)p + RS_HEADER_BYTES, .off = off, .rows = rows,
+                               .n_chunks = n_chunks, .seats = (int)h.seats, .key_col = key_col[by], .tid = t,
+                               .n_threads = n_threads, .acc = &acc[t]};
+        if (pthread_create(&th[t], NULL, rq_scan_thread, &scans[t]) != 0)
         {
-            if (change.table_id < 0 || change.table_id >= psa->n_tables)
-                continue;
+            perror("pthread_create(query)");
+            rq_scan_thread(&scans[t]); // sin hilo: sus bloques se recorren aquí
+            scans[t].n_chunks = 0;     // marca: no hay que unirlo
+        }
+    }
+    for (int t = 0; t < n_threads; t++)
+        if (scans[t].n_chunks)
+            pthread_join(th[t], NULL);
 
-            game_state_t *g = &psa->tables[change.table_id];
-            pthread_mutex_lock(&g->mtx);
-            if (!g->finished)
-            {
-                if (change.change_policy)
-                    supervisor_apply_policy_change(g, change.new_policy, " (solicitado)");
-            }
-            pthread_mutex_unlock(&g->mtx);
+    // acumuladores por hilo -> acc[0] (todos los campos son uint64_t); la fila TOTAL va aparte
+    uint64_t *sum = (uint64_t *)&acc[0];
+    for (int t = 1; t < n_threads; t++)
+    {
+        const uint64_t *part = (const uint64_t *)&acc[t];
+        for (size_t w = 0; w < sizeof(rq_acc_t) / sizeof(uint64_t); w++)
+            sum[w] += part[w];
+    }
+    rq_acc_t *total = calloc(1, sizeof(rq_acc_t));
+    if (!total)
+    {
+        perror("calloc");
+        return 1;
+    }
+    for (int g = 0; g < RQ_GROUPS; g++)
+    {
+        total->games[0] += acc[0].games[g];
+        total->dur_us[0] += acc[0].dur_us[g];
+        for (int e = 0; e < 4; e++)
+            total->by_end[0][e] += acc[0].by_end[g][e];
+        for (int s = 0; s < RS_MAX_SEATS; s++)
+            total->wins[0][s] += acc[0].wins[g][s];
+        for (int b = 0; b < RQ_STEP_BINS; b++)
+            total->steps[0][b] += acc[0].steps[g][b];
+    }
+    double secs = (now_ns() - t0) / 1e9;
+    int seats = 2; // columnas de victorias: hasta el último asiento que ganó alguna vez
+    for (int s = 0; s < (int)h.seats; s++)
+        if (total->wins[0][s])
+            seats = s + 1 > seats ? s + 1 : seats;
+    size_t row_bytes = RS_WIDTH[key_col[by]] + RS_WIDTH[RS_END] + RS_WIDTH[RS_STEPS] + RS_WIDTH[RS_WINNER] +
+                       RS_WIDTH[RS_DURATION];
+
+    printf("[Consulta] %s: %llu filas en %llu bloques, %d hilos, %.3f s (%.1f Mfilas/s, %.0f MB/s de columnas)\n",
+           path, (unsigned long long)rows, (unsigned long long)n_chunks, n_threads, secs,
+           secs > 0 ? rows / secs / 1e6 : 0.0, secs > 0 ? rows * row_bytes / secs / 1e6 : 0.0);
+    // printf cuenta bytes: las tildes ocupan dos
+    printf("%-*s %11s %7s %7s %8s %7s %5s %5s %5s %6s %9s  %s\n", by == RQ_BY_POLICY0 || by == RQ_BY_POLICY ? 15 : 14,
+           by_title[by], "partidas", "domina", "bloqueo", "límite", "pasos", "p50", "p90", "p99", "máx", "dur. ms",
+           "victorias por asiento (%)");
+    for (int g = 0; g < RQ_GROUPS; g++)
+    {
+        if (!acc[0].games[g])
+            continue;
+        char label[32];
+        rq_label(by, g, label, sizeof(label));
+        rq_print_row(label, &acc[0], g, seats);
+    }
+    rq_print_row("TOTAL", total, 0, seats);
+
+    free(total);
+    free(acc);
+    free(th);
+    free(scans);
+    munmap(p, len);
+    return 0;
+}
+
+/* ===== modo distribuido: coordinador + procesos trabajadores =====
+ * El coordinador (--workers=N) reparte las mesas entre N procesos hijos, cada
+ * uno con su propio validador, supervisores y planificadores, conectados por
+ * sockets Unix (socketpair). Protocolo binario: cabecera {tipo, cuenta} y
+ * 'cuenta' registros de tamaño fijo:
+ *   C->W HELLO    cuenta = capacidad total de mesas
+ *   W->C REQUEST  cuenta = mesas que el trabajador quiere recibir
+ *   C->W ASSIGN   cuenta x table_spec_t
+ *   C->W NO_MORE  no quedan mesas
+ *   W->C RESULTS  cuenta x table_result_t (lotes de hasta --worker-batch o cada 20 ms)
+ *   W->C CACHE    cuenta x oc_entry_t (solo con --outcome-cache-file, al terminar)
+ *   W->C STATS    1 x worker_stats_t, justo antes de salir
+ * El reparto es por demanda: un trabajador pide otro lote cuando vacía su
+ * bandeja de entrada, y solo arranca mesas mientras tenga menos de
+ * --worker-inflight activas; las mesas nuevas van así a los más ociosos.
+ * Si un trabajador muere, las mesas que tenía sin resultado se reasignan.
+ * Cada trabajador tiene su copia de la caché de resultados (la heredada al
+ * hacer fork más lo que guarde); al terminar la envía y el coordinador la
+ * funde en la suya, que es la que se guarda en --outcome-cache-file.
+ */
+enum
+{
+    MSG_HELLO = 1,
+    MSG_REQUEST,
+    MSG_ASSIGN,
+    MSG_NO_MORE,
+    MSG_RESULTS,
+    MSG_STATS,
+    MSG_CACHE
+};
+
+#define OC_WIRE_BATCH 256 // entradas de caché por mensaje CACHE
+
+typedef struct
+{
+    uint32_t type, count;
+} wire_hdr_t;
+
+typedef struct
+{
+    int64_t actions, turns, turn_sum_ns, turn_max_ns;
+    double secs;
+    uint64_t hist[LAT_BUCKETS];
+} worker_stats_t;
+
+// MSG_NOSIGNAL: si el otro extremo cerró, EPIPE en vez de SIGPIPE (que mataría al coordinador)
+static int write_full(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0)
+    {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR)
             continue;
-        }
-        if (popped == -1)
-            stop_requested = 1;
-        if (stop_requested && all_tables_finished(psa->tables, psa->n_tables))
-            break;
+        if (w <= 0)
+            return -1;
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
 
-        sleep_ms(50);
+static int read_full(int fd, void *buf, size_t len)
+{
+    char *p = (char *)buf;
+    while (len > 0)
+    {
+        ssize_t r = read(fd, p, len);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return -1;
+        p += r;
+        len -= (size_t)r;
     }
+    return 0;
+}
 
-    return NULL;
+static int send_msg(int fd, uint32_t type, uint32_t count, const void *body, size_t rec_size)
+{
+    wire_hdr_t h = {type, count};
+    if (write_full(fd, &h, sizeof(h)) != 0)
+        return -1;
+    return count && body ? write_full(fd, body, rec_size * count) : 0;
 }
 
-/* ===== planificador por mesa ===== */
-static int pick_next_fcfs(game_state_t *g, int current)
+/* ----- trabajador ----- */
+typedef struct
 {
-    return (current + 1) % g->nplayers;
+    int fd;
+    pthread_mutex_t mtx; // serializa escrituras al socket y protege el estado
+    pthread_cond_t cv;
+    table_result_t *outbox;
+    int out_n;
+    table_spec_t *inbox;
+    int in_head, in_n;
+    int active, requested, no_more, stop;
+} worker_ctx_t;
+
+static worker_ctx_t WK;
+
+static void worker_flush_locked(void)
+{
+    if (WK.out_n == 0)
+        return;
+    if (send_msg(WK.fd, MSG_RESULTS, (uint32_t)WK.out_n, WK.outbox, sizeof(table_result_t)) != 0)
+        _exit(3); // el coordinador desapareció
+    WK.out_n = 0;
 }
-static int pick_next_rr(game_state_t *g, int current)
+
+static void worker_on_result(const table_result_t *r)
 {
-    // por ahora 1 acción por turno => igual a FCFS; luego podemos permitir N acciones por quantum
-    (void)g;
-    return (current + 1) % g->nplayers;
+    MTX_LOCK(&WK.mtx, "WK");
+    WK.outbox[WK.out_n++] = *r;
+    WK.active--;
+    if (WK.out_n == CFG.worker_batch)
+        worker_flush_locked();
+    pthread_cond_signal(&WK.cv);
+    MTX_UNLOCK(&WK.mtx);
 }
-static int pick_next_sjf_points(game_state_t *g)
+
+void *worker_flush_thread(void *arg)
 {
-    int best = -1, best_pts = INT_MAX, best_tiles = INT_MAX;
-    for (int p = 0; p < g->nplayers; p++)
+    (void)arg;
+    MTX_LOCK(&WK.mtx, "WK");
+    while (!WK.stop)
     {
-        int pts = hand_points(g, p), tiles = g->hand_len[p];
-        if (pts < best_pts || (pts == best_pts && tiles < best_tiles) || (pts == best_pts && tiles == best_tiles && p < best))
-        {
-            best = p;
-            best_pts = pts;
-            best_tiles = tiles;
-        }
+        worker_flush_locked();
+        MTX_UNLOCK(&WK.mtx);
+        sleep_ms(20);
+        MTX_LOCK(&WK.mtx, "WK");
     }
-    return best;
+    MTX_UNLOCK(&WK.mtx);
+    return NULL;
 }
-static int pick_next_sjf_players(game_state_t *g)
+
+static int worker_next(table_source_t *src, table_spec_t *out)
 {
-    int best = -1, best_tiles = INT_MAX;
-    for (int p = 0; p < g->nplayers; p++)
+    (void)src;
+    MTX_LOCK(&WK.mtx, "WK");
+    for (;;)
     {
-        int tiles = g->hand_len[p];
-        if (tiles < best_tiles || (tiles == best_tiles && p < best))
+        if (WK.in_n > 0 && WK.active < CFG.worker_inflight)
         {
-            best = p;
-            best_tiles = tiles;
+            *out = WK.inbox[WK.in_head++];
+            WK.in_n--;
+            WK.active++;
+            MTX_UNLOCK(&WK.mtx);
+            return 1;
+        }
+        if (WK.in_n > 0)
+        {
+            // bandeja con mesas pero ya hay demasiadas activas
+            CV_WAIT(&WK.cv, &WK.mtx);
+            continue;
+        }
+        if (WK.no_more)
+        {
+            MTX_UNLOCK(&WK.mtx);
+            return 0;
+        }
+        if (!WK.requested)
+        {
+            if (send_msg(WK.fd, MSG_REQUEST, (uint32_t)CFG.worker_batch, NULL, 0) != 0)
+                _exit(3);
+            WK.requested = 1;
+        }
+        MTX_UNLOCK(&WK.mtx);
+
+        // solo este hilo lee del socket
+        wire_hdr_t h;
+        if (read_full(WK.fd, &h, sizeof(h)) != 0)
+            _exit(3);
+        MTX_LOCK(&WK.mtx, "WK");
+        WK.requested = 0;
+        if (h.type == MSG_NO_MORE)
+            WK.no_more = 1;
+        else if (h.type == MSG_ASSIGN)
+        {
+            if (h.count > (uint32_t)CFG.worker_batch ||
+                read_full(WK.fd, WK.inbox, sizeof(table_spec_t) * h.count) != 0)
+                _exit(3);
+            WK.in_head = 0;
+            WK.in_n = (int)h.count;
         }
     }
-    return best;
 }
-static int pick_next_player(game_state_t *g, int current)
+
+// entradas ocupadas de la caché local, en lotes; -1 => el coordinador no está
+static int worker_send_cache(int fd)
 {
-    switch (g->policy)
+    oc_entry_t buf[OC_WIRE_BATCH];
+    int n = 0;
+    for (size_t i = 0; i < (size_t)OC.n_sets * OC_WAYS; i++)
     {
-    case FCFS:
-        return pick_next_fcfs(g, current);
-    case RR:
-        return pick_next_rr(g, current);
-    case SJF_POINTS:
-        return pick_next_sjf_points(g);
-    case SJF_PLAYERS:
-        return pick_next_sjf_players(g);
+        if (OC.e[i].key.h[0] == 0 && OC.e[i].key.h[1] == 0)
+            continue;
+        buf[n++] = OC.e[i];
+        if (n == OC_WIRE_BATCH)
+        {
+            if (send_msg(fd, MSG_CACHE, (uint32_t)n, buf, sizeof(oc_entry_t)) != 0)
+                return -1;
+            n = 0;
+        }
     }
-    return (current + 1) % g->nplayers;
+    return n ? send_msg(fd, MSG_CACHE, (uint32_t)n, buf, sizeof(oc_entry_t)) : 0;
 }
 
-void *scheduler_thread(void *arg)
+static int worker_main(int fd)
 {
-    game_state_t *g = (game_state_t *)arg;
+    CFG.quiet = 1;
+    wire_hdr_t h;
+    if (read_full(fd, &h, sizeof(h)) != 0 || h.type != MSG_HELLO || h.count == 0)
+        return 3;
 
-    pthread_mutex_lock(&g->mtx);
-    int current = g->turn; // ya viene inicializado por choose_opening
-    pthread_mutex_unlock(&g->mtx);
+    memset(&WK, 0, sizeof(WK));
+    WK.fd = fd;
+    WK.outbox = malloc(sizeof(table_result_t) * CFG.worker_batch);
+    WK.inbox = malloc(sizeof(table_spec_t) * CFG.worker_batch);
+    if (!WK.outbox || !WK.inbox)
+        return 3;
+    pthread_mutex_init(&WK.mtx, NULL);
+    pthread_cond_init(&WK.cv, NULL);
+    RESULT_HOOK = worker_on_result;
+    RS.hdr = NULL; // el almacén lo escribe el coordinador con lo que recibe
 
-    for (;;)
+    pthread_t th_flush;
+    if (pthread_create(&th_flush, NULL, worker_flush_thread, NULL) != 0)
+        return 3;
+
+    // nunca hay más de --worker-inflight mesas activas: las ranuras se reutilizan
+    table_source_t src = {.next = worker_next, .ctx = NULL};
+    run_report_t rep;
+    int rc = run_simulation(CFG.worker_inflight < (int)h.count ? CFG.worker_inflight : (int)h.count, 0, &src, &rep);
+
+    MTX_LOCK(&WK.mtx, "WK");
+    WK.stop = 1;
+    worker_flush_locked();
+    if (OC.e && CFG.outcome_cache_file && worker_send_cache(fd) != 0)
+        _exit(3);
+    worker_stats_t ws = {
+        .actions = rep.actions,
+        .turns = (int64_t)TURN_HIST.count,
+        .turn_sum_ns = TURN_HIST.sum_ns,
+        .turn_max_ns = TURN_HIST.max_ns,
+        .secs = rep.secs,
+    };
+    memcpy(ws.hist, TURN_HIST.b, sizeof(ws.hist));
+    send_msg(fd, MSG_STATS, 1, &ws, sizeof(ws));
+    MTX_UNLOCK(&WK.mtx);
+    pthread_join(th_flush, NULL);
+    close(fd);
+    if (OC.e)
     {
-        pthread_mutex_lock(&g->mtx);
-        if (g->finished)
-        {
-            pthread_mutex_unlock(&g->mtx);
-            break;
-        }
+        printf("[Caché] trabajador %d\n", (int)getpid());
+        oc_print_stats();
+    }
+    if (CFG.lock_stats)
+    {
+        printf("[Locks] trabajador %d\n", (int)getpid());
+        lock_stats_report();
+    }
+    if (CFG.trace_out)
+    {
+        // un fichero por trabajador: f.json -> f.json.<pid>
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s.%d", CFG.trace_out, (int)getpid());
+        trace_export(path);
+    }
+    return rc;
+}
 
-        // programar al 'current': despertar jugadores
-        g->action_done = 0;
-        // g->turn ya apunta a current
-        pthread_cond_broadcast(&g->cv);
+/* ----- coordinador ----- */
+typedef struct
+{
+    int fd;
+    pid_t pid;
+    int alive, pending_request, got_stats;
+    long assigned, completed;
+} worker_slot_t;
 
-        // esperar a que el validador aplique UNA acción
-        while (!g->finished && !g->action_done)
-            pthread_cond_wait(&g->cv, &g->mtx);
-        if (g->finished)
-        {
-            pthread_mutex_unlock(&g->mtx);
-            break;
-        }
+typedef struct
+{
+    int total, next_gid, completed;
+    int *owner;      // trabajador dueño de cada mesa (-1 => sin asignar)
+    char *done;
+    int *retry;      // mesas a reasignar tras la caída de un trabajador
+    int n_retry;
+    long by_reason[4], wins_by_seat[MAX_PLAYERS];
+    long long steps_sum, duration_us_sum;
+} coord_state_t;
 
-        // decidir siguiente según política
-        int next = pick_next_player(g, current);
-        g->turn = next;
-        current = next;
+static int coord_take_spec(coord_state_t *cs, table_spec_t *out)
+{
+    int gid;
+    if (cs->n_retry > 0)
+        gid = cs->retry[--cs->n_retry];
+    else if (cs->next_gid < cs->total)
+        gid = cs->next_gid++;
+    else
+        return 0;
+    out->gid = gid;
+    out->seed = table_seed(CFG.seed, gid);
+    out->nplayers = table_players(out->seed);
+    out->policy = (uint8_t)CFG.default_policy;
+    out->auto_policy = (uint8_t)CFG.auto_policy;
+    return 1;
+}
 
-        pthread_mutex_unlock(&g->mtx);
+// contesta una petición: lote, NO_MORE, o la deja pendiente si aún hay mesas en vuelo
+// -1 => el envío falló (trabajador caído: EPIPE)
+static int coord_serve(coord_state_t *cs, worker_slot_t *w, int wi, table_spec_t *batch)
+{
+    int n = 0;
+    while (n < CFG.worker_batch && coord_take_spec(cs, &batch[n]))
+    {
+        cs->owner[batch[n].gid] = wi;
+        n++;
     }
-    return NULL;
+    if (n > 0)
+    {
+        w->pending_request = 0;
+        w->assigned += n;
+        return send_msg(w->fd, MSG_ASSIGN, (uint32_t)n, batch, sizeof(table_spec_t));
+    }
+    else if (cs->completed == cs->total)
+    {
+        w->pending_request = 0;
+        return send_msg(w->fd, MSG_NO_MORE, 0, NULL, 0);
+    }
+    else
+    {
+        w->pending_request = 1; // quizá haya que reasignar mesas de un trabajador caído
+    }
+    return 0;
 }
 
-/* ===== mesa ===== */
-static void init_table(game_state_t *g, int table_id, int nplayers, policy_t pol)
+static void coord_worker_lost(coord_state_t *cs, worker_slot_t *w, int wi)
 {
-    memset(g, 0, sizeof(*g));
-    g->table_id = table_id;
-    g->nplayers = nplayers;
-    g->max_steps = 800;
-    g->steps = 0;
-    g->pass_streak = 0;
-    g->policy = pol;
-    g->rr_quantum_ms = 200; // reservado (futuro)
-    g->turn_cooldown_ms = DEFAULT_TURN_COOLDOWN_MS;
-    g->action_done = 0;
-    pthread_mutex_init(&g->mtx, NULL);
-    pthread_cond_init(&g->cv, NULL);
+    w->alive = 0;
+    close(w->fd);
+    if (w->got_stats)
+        return;
+    int lost = 0;
+    for (int gid = 0; gid < cs->next_gid; gid++)
+        if (cs->owner[gid] == wi && !cs->done[gid])
+        {
+            cs->owner[gid] = -1;
+            cs->retry[cs->n_retry++] = gid;
+            lost++;
+        }
+    printf("[Coordinador] trabajador %d (pid %d) cayó; se reasignan %d mesas\n", wi, (int)w->pid, lost);
 }
 
-void *table_thread(void *arg)
+static int run_coordinator(int n_tables, int n_workers)
 {
-    game_state_t *g = (game_state_t *)arg;
+    worker_slot_t *ws = calloc(n_workers, sizeof(*ws));
+    coord_state_t cs = {.total = n_tables};
+    cs.owner = malloc(sizeof(int) * n_tables);
+    cs.done = calloc(n_tables, 1);
+    cs.retry = malloc(sizeof(int) * n_tables);
+    table_spec_t *batch = malloc(sizeof(table_spec_t) * CFG.worker_batch);
+    table_result_t *rbuf = malloc(sizeof(table_result_t) * CFG.worker_batch);
+    oc_entry_t *cbuf = malloc(sizeof(oc_entry_t) * OC_WIRE_BATCH);
+    if (!ws || !cs.owner || !cs.done || !cs.retry || !batch || !rbuf || !cbuf)
+    {
+        perror("alloc coordinador");
+        return 1;
+    }
+    for (int i = 0; i < n_tables; i++)
+        cs.owner[i] = -1;
 
-    deal_hands(g);
-    int opener = -1;
-    tile_t first;
-    choose_opening(g, &opener, &first);
-
-    pthread_mutex_lock(&g->mtx);
-    printf("\n=== Mesa %d: %d jugadores — Política: %s ===\n", g->table_id, g->nplayers,
-           policy_name(g->policy));
-    printf("Apertura: Jugador %d juega ", opener);
-    print_tile(first);
-    printf("  -> extremos: %d y %d\n", g->left_end, g->right_end);
-    for (int p = 0; p < g->nplayers; p++)
+    for (int w = 0; w < n_workers; w++)
     {
-        printf("Mano J%d (%2d fichas): ", p, g->hand_len[p]);
-        for (int i = 0; i < g->hand_len[p]; i++)
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
         {
-            print_tile(g->hands[p][i]);
-            printf(" ");
+            perror("socketpair");
+            return 1;
         }
-        printf("\n");
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0)
+        {
+            close(sv[0]);
+            for (int k = 0; k < w; k++)
+                close(ws[k].fd);
+            _exit(worker_main(sv[1]));
+        }
+        close(sv[1]);
+        ws[w] = (worker_slot_t){.fd = sv[0], .pid = pid, .alive = 1};
+        send_msg(ws[w].fd, MSG_HELLO, (uint32_t)n_tables, NULL, 0);
     }
-    printf("Pozo: %d fichas\n", g->pool_len);
-    pthread_mutex_unlock(&g->mtx);
+    printf("[Coordinador] %d mesas en %d trabajadores (lotes de %d, hasta %d activas por trabajador)\n",
+           n_tables, n_workers, CFG.worker_batch, CFG.worker_inflight);
 
-    // jugadores
-    pthread_t th_players[MAX_PLAYERS];
-    for (int p = 0; p < g->nplayers; p++)
+    long long t0 = now_ns();
+    worker_stats_t total = {0};
+    struct pollfd *pfd = malloc(sizeof(struct pollfd) * n_workers);
+    int *pidx = malloc(sizeof(int) * n_workers);
+    int alive = n_workers;
+    while (alive > 0)
     {
-        player_args_t *pa = malloc(sizeof(*pa));
-        pa->g = g;
-        pa->pid = p;
-        if (pthread_create(&th_players[p], NULL, player_thread, pa) != 0)
+        int np = 0;
+        for (int w = 0; w < n_workers; w++)
+            if (ws[w].alive)
+            {
+                pidx[np] = w;
+                pfd[np++] = (struct pollfd){.fd = ws[w].fd, .events = POLLIN};
+            }
+        if (poll(pfd, np, -1) < 0 && errno != EINTR)
+            break;
+
+        for (int k = 0; k < np; k++)
         {
-            perror("pthread_create(player)");
-            exit(1);
+            int w = pidx[k];
+            if (!(pfd[k].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            worker_slot_t *wk = &ws[w];
+            wire_hdr_t h;
+            if (read_full(wk->fd, &h, sizeof(h)) != 0)
+            {
+                coord_worker_lost(&cs, wk, w);
+                alive--;
+                continue;
+            }
+            if (h.type == MSG_REQUEST)
+            {
+                if (coord_serve(&cs, wk, w, batch) != 0)
+                {
+                    coord_worker_lost(&cs, wk, w);
+                    alive--;
+                    continue;
+                }
+            }
+            else if (h.type == MSG_RESULTS && h.count <= (uint32_t)CFG.worker_batch &&
+                     read_full(wk->fd, rbuf, sizeof(table_result_t) * h.count) == 0)
+            {
+                for (uint32_t i = 0; i < h.count; i++)
+                {
+                    table_result_t *r = &rbuf[i];
+                    if (r->gid < 0 || r->gid >= n_tables || cs.done[r->gid])
+                        continue;
+                    cs.done[r->gid] = 1;
+                    rs_append(r);
+                    cs.completed++;
+                    wk->completed++;
+                    if (r->end_reason < 4)
+                        cs.by_reason[r->end_reason]++;
+                    if (r->winner >= 0 && r->winner < MAX_PLAYERS)
+                        cs.wins_by_seat[r->winner]++;
+                    cs.steps_sum += r->steps;
+                    cs.duration_us_sum += r->duration_us;
+                }
+            }
+            else if (h.type == MSG_CACHE && h.count <= OC_WIRE_BATCH && OC.e &&
+                     read_full(wk->fd, cbuf, sizeof(oc_entry_t) * h.count) == 0)
+            {
+                for (uint32_t i = 0; i < h.count; i++)
+                    oc_insert(&cbuf[i]);
+            }
+            else if (h.type == MSG_STATS && h.count == 1)
+            {
+                worker_stats_t st;
+                if (read_full(wk->fd, &st, sizeof(st)) == 0)
+                {
+                    wk->got_stats = 1;
+                    total.actions += st.actions;
+                    total.turns += st.turns;
+                    total.turn_sum_ns += st.turn_sum_ns;
+                    if (st.turn_max_ns > total.turn_max_ns)
+                        total.turn_max_ns = st.turn_max_ns;
+                    for (int b = 0; b < LAT_BUCKETS; b++)
+                        total.hist[b] += st.hist[b];
+                }
+            }
+            else
+            {
+                coord_worker_lost(&cs, wk, w); // mensaje corrupto
+                alive--;
+                continue;
+            }
         }
-    }
 
-    // planificador por mesa
-    pthread_t th_sched;
-    if (pthread_create(&th_sched, NULL, scheduler_thread, g) != 0)
-    {
-        perror("pthread_create(scheduler)");
-        exit(1);
+        // peticiones pendientes: reasignaciones o fin del trabajo
+        for (int w = 0; w < n_workers; w++)
+            if (ws[w].alive && ws[w].pending_request && coord_serve(&cs, &ws[w], w, batch) != 0)
+            {
+                coord_worker_lost(&cs, &ws[w], w);
+                alive--;
+            }
     }
 
-    // esperar fin de mesa
-    pthread_mutex_lock(&g->mtx);
-    while (!g->finished)
-        pthread_cond_wait(&g->cv, &g->mtx);
-    pthread_mutex_unlock(&g->mtx);
-    pthread_cond_broadcast(&g->cv);
-
-    pthread_join(th_sched, NULL);
-    for (int p = 0; p < g->nplayers; p++)
-        pthread_join(th_players[p], NULL);
-    printf("=== Mesa %d: terminó ===\n", g->table_id);
-    return NULL;
-}
+    for (int w = 0; w < n_workers; w++)
+        waitpid(ws[w].pid, NULL, 0);
+    double secs = (now_ns() - t0) / 1e9;
 
-/* ===== main ===== */
-typedef struct
-{
-    game_state_t *tables;
-    int n_tables;
-} validator_args_2; // alias para claridad
+    lat_hist_t merged = {.count = (uint64_t)total.turns, .sum_ns = total.turn_sum_ns, .max_ns = total.turn_max_ns};
+    memcpy(merged.b, total.hist, sizeof(merged.b));
+    printf("\n=== Coordinador: resumen combinado ===\n");
+    printf("Mesas completadas: %d/%d en %.2f s (%.1f mesas/s)\n", cs.completed, n_tables, secs,
+           secs > 0 ? cs.completed / secs : 0.0);
+    printf("Fin: domina=%ld bloqueo=%ld límite=%ld | pasos medios=%.1f | duración media=%.2f ms\n",
+           cs.by_reason[END_DOMINA], cs.by_reason[END_BLOCKED], cs.by_reason[END_STEP_LIMIT],
+           cs.completed ? (double)cs.steps_sum / cs.completed : 0.0,
+           cs.completed ? cs.duration_us_sum / 1e3 / cs.completed : 0.0);
+    printf("Victorias por asiento:");
+    for (int p = 0; p < CFG.max_players; p++)
+        printf(" J%d=%ld", p, cs.wins_by_seat[p]);
+    printf("\n[Stats] acciones=%lld (%.0f/s) latencia de turno: p50=%.3f ms p99=%.3f ms máx=%.3f ms\n",
+           (long long)total.actions, secs > 0 ? total.actions / secs : 0.0, lat_hist_pct_ms(&merged, 0.50),
+           lat_hist_pct_ms(&merged, 0.99), merged.max_ns / 1e6);
+    for (int w = 0; w < n_workers; w++)
+        printf("  trabajador %d (pid %d): %ld asignadas, %ld completadas%s\n", w, (int)ws[w].pid, ws[w].assigned,
+               ws[w].completed, ws[w].got_stats ? "" : " [caído]");
 
-void *validator_thread(void *); // fwd
+    int ok = cs.completed == n_tables;
+    free(pidx);
+    free(pfd);
+    free(rbuf);
+    free(cbuf);
+    free(batch);
+    free(cs.retry);
+    free(cs.done);
+    free(cs.owner);
+    free(ws);
+    return ok ? 0 : 1;
+}
 
-int main(void)
+int main(int argc, char **argv)
 {
-    srand((unsigned)time(NULL));
+    parse_args(argc, argv);
     setvbuf(stdout, NULL, _IONBF, 0);
-    int n_tables = 0;
-    char input_buf[32];
+    tile_masks_init(); // antes de cualquier fork: los trabajadores heredan las tablas
+    engine_select_kernels(CFG.pips);
+    if (CFG.tail_events)
+        return evt_tail(CFG.tail_events);
+    if (CFG.query)
+        return rs_query(CFG.query, CFG.query_by);
+    if (CFG.seed == 0)
+        CFG.seed = (unsigned)time(NULL);
+    srand(CFG.seed);
 
-    printf("¿Cuántas mesas quieres crear? ");
-    fflush(stdout);
-    if (!fgets(input_buf, sizeof(input_buf), stdin) || sscanf(input_buf, "%d", &n_tables) != 1 || n_tables <= 0)
+    topology_detect(&TOPO);
+    topology_print(&TOPO);
+    if (CFG.workers > 0 && CFG.events_shm)
     {
-        puts("Valor inválido.");
-        return 1;
+        fprintf(stderr, "--events no está disponible con --workers (el anillo tiene un solo productor)\n");
+        CFG.events_shm = NULL;
     }
-
-    // Puedes cambiar la política por defecto aquí:
-    policy_t default_policy = SJF_POINTS; // FCFS | SJF_POINTS | SJF_PLAYERS | RR
-
-    game_state_t *tables = calloc(n_tables, sizeof(game_state_t));
-    pthread_t *th_tables = calloc(n_tables, sizeof(pthread_t));
-    if (!tables || !th_tables)
-    {
-        perror("alloc");
+    if (CFG.events_shm && evt_open_producer(CFG.events_shm, (uint64_t)CFG.events_cap) != 0)
         return 1;
-    }
 
-    // Validador único global
-    q_init(&GQ);
-    policy_q_init(&POLICY_Q);
-    validator_args_t va = {.tables = tables, .n_tables = n_tables};
-    pthread_t th_validator;
-    if (pthread_create(&th_validator, NULL, validator_thread, &va) != 0)
+    if (CFG.saturate)
     {
-        perror("pthread_create(validator)");
-        return 1;
+        if (CFG.outcome_cache > 0)
+            fprintf(stderr, "--outcome-cache no se usa con --saturate: cada prueba debe jugarse entera\n");
+        if (CFG.results)
+            fprintf(stderr, "--results no se usa con --saturate: las pruebas repiten repartos\n");
+        CFG.quiet = 1;
+        saturation_search();
+        evt_close_producer();
+        lock_stats_report();
+        return 0;
     }
 
-    policy_supervisor_args_t psa = {.tables = tables, .n_tables = n_tables};
-    pthread_t th_policy_supervisor;
-    if (pthread_create(&th_policy_supervisor, NULL, policy_supervisor_thread, &psa) != 0)
+    if (CFG.autotune)
     {
-        perror("pthread_create(policy_supervisor)");
-        return 1;
+        if (CFG.outcome_cache > 0)
+            fprintf(stderr, "--outcome-cache no se usa con --autotune: cada prueba debe jugarse entera\n");
+        if (CFG.workers > 0)
+            fprintf(stderr, "--workers no está disponible con --autotune: las pruebas corren en este proceso\n");
+        if (CFG.results)
+            fprintf(stderr, "--results no se usa con --autotune: las pruebas repiten repartos\n");
+        CFG.quiet = 1;
+        int rc = autotune();
+        evt_close_producer();
+        lock_stats_report();
+        return rc;
     }
 
-    // Hilo de control en caliente (consola)
-    control_args_t ca = {.tables = tables, .n_tables = n_tables};
-    pthread_t th_control;
-    int control_thread_started = 0;
-    if (pthread_create(&th_control, NULL, control_thread, &ca) != 0)
-    {
-        perror("pthread_create(control)"); /* no abortamos; solo avisamos */
-    }
-    else
+    if (CFG.outcome_cache > 0)
     {
-        control_thread_started = 1;
+        // antes de --workers: los trabajadores heredan la caché cargada
+        oc_init(CFG.outcome_cache);
+        if (CFG.outcome_cache_file)
+            oc_load(CFG.outcome_cache_file);
     }
+    // con --workers escribe solo el coordinador
+    if (CFG.results && rs_open(CFG.results) != 0)
+        return 1;
 
-    // Lanzar mesas con la política elegida
-    for (int i = 0; i < n_tables; i++)
+    int n_tables = CFG.n_tables;
+    char input_buf[32];
+
+    if (n_tables <= 0)
     {
-        int np = 2 + rand() % 3;
-        init_table(&tables[i], i, np, default_policy);
-        if (pthread_create(&th_tables[i], NULL, table_thread, &tables[i]) != 0)
+        printf("¿Cuántas mesas quieres crear? ");
+        fflush(stdout);
+        if (!fgets(input_buf, sizeof(input_buf), stdin) || sscanf(input_buf, "%d", &n_tables) != 1 || n_tables <= 0)
         {
-            perror("pthread_create(table)");
+            puts("Valor inválido.");
             return 1;
         }
     }
 
-    for (int i = 0; i < n_tables; i++)
-        pthread_join(th_tables[i], NULL);
-    pthread_join(th_validator, NULL);
-    if (control_thread_started)
-        pthread_join(th_control, NULL);
+    if (CFG.experiment)
+    {
+        if (CFG.workers > 0)
+            fprintf(stderr, "--workers no está disponible con --experiment: se ejecuta en este proceso\n");
+        CFG.quiet = 1;
+        int rc = run_experiment(n_tables);
+        if (CFG.outcome_cache_file)
+            oc_save(CFG.outcome_cache_file);
+        rs_close();
+        evt_close_producer();
+        lock_stats_report();
+        if (CFG.trace_out)
+            trace_export(CFG.trace_out);
+        return rc;
+    }
 
-    policy_q_stop(&POLICY_Q);
-    pthread_join(th_policy_supervisor, NULL);
+    if (CFG.workers > 0)
+    {
+        int rc = run_coordinator(n_tables, CFG.workers);
+        if (CFG.outcome_cache_file)
+            oc_save(CFG.outcome_cache_file); // ya fundida con las de los trabajadores
+        rs_close();
+        return rc;
+    }
 
-    q_destroy(&GQ);
-    policy_q_destroy(&POLICY_Q);
+    arrival_source_t arr = {.n = n_tables, .rng = {.s = CFG.seed * 0x2545f4914f6cdd1dULL + 1}};
+    table_source_t src = {.next = arrival_next, .peek = arrival_peek, .ctx = &arr};
+    if (run_simulation(n_tables, 1, &src, NULL) != 0)
+        return 1;
+    if (CFG.outcome_cache_file)
+        oc_save(CFG.outcome_cache_file);
+    rs_close();
+    evt_close_producer();
+    lock_stats_report();
+    if (CFG.trace_out)
+        trace_export(CFG.trace_out);
     puts("\nTodas las mesas han terminado.");
-    free(th_tables);
-    free(tables);
     return 0;
 }